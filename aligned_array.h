@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+// Alignment of every projectile column; one cache line, also enough for AVX-512 loads
+const std::size_t PROJECTILE_ALIGNMENT = 64;
+
+// Growable array of trivially copyable values whose storage is PROJECTILE_ALIGNMENT-aligned.
+// It can also adopt an array it does not own (a mapped file's, say) and work on
+// it in place until it has to grow, when the contents move into storage of its own.
+template <typename T>
+class AlignedArray {
+public:
+    AlignedArray() : data_(nullptr), size_(0), capacity_(0), borrowed_(false) {}
+    ~AlignedArray() { release(); }
+
+    AlignedArray(const AlignedArray&) = delete;
+    AlignedArray& operator=(const AlignedArray&) = delete;
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    bool borrowed() const { return borrowed_; }
+
+    T& operator[](std::size_t i) { return data_[i]; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    T& back() { return data_[size_ - 1]; }
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    void reserve(std::size_t newCapacity) {
+        if (newCapacity <= capacity_) {
+            return;
+        }
+        T* newData = static_cast<T*>(::operator new(newCapacity * sizeof(T), std::align_val_t(PROJECTILE_ALIGNMENT)));
+        if (size_ > 0) {
+            std::memcpy(newData, data_, size_ * sizeof(T));
+        }
+        release();
+        data_ = newData;
+        capacity_ = newCapacity;
+    }
+
+    // New elements are left uninitialized
+    void resize(std::size_t newSize) {
+        reserve(newSize);
+        size_ = newSize;
+    }
+
+    // New elements are set to `value`
+    void resize(std::size_t newSize, const T& value) {
+        std::size_t oldSize = size_;
+        resize(newSize);
+        for (std::size_t i = oldSize; i < newSize; ++i) {
+            data_[i] = value;
+        }
+    }
+
+    void push_back(T value) {
+        if (size_ == capacity_) {
+            reserve(capacity_ == 0 ? 256 : capacity_ * 2);
+        }
+        data_[size_++] = value;
+    }
+
+    void pop_back() { --size_; }
+
+    // Replaces the contents with a copy of [first, last)
+    void assign(const T* first, const T* last) {
+        std::size_t count = static_cast<std::size_t>(last - first);
+        resize(count);
+        if (count > 0) {
+            std::memcpy(data_, first, count * sizeof(T));
+        }
+    }
+
+    void clear() { size_ = 0; }
+
+    // Uses the `count` elements at `external` as the contents, without copying.
+    // They must stay valid and writable until the array grows past `count`, and
+    // be PROJECTILE_ALIGNMENT-aligned if the caller relies on that.
+    void adopt(T* external, std::size_t count) {
+        release();
+        data_ = external;
+        size_ = count;
+        capacity_ = count;
+        borrowed_ = true;
+    }
+
+private:
+    void release() {
+        if (data_ && !borrowed_) {
+            ::operator delete(data_, std::align_val_t(PROJECTILE_ALIGNMENT));
+        }
+        data_ = nullptr;
+        borrowed_ = false;
+    }
+
+    T* data_;
+    std::size_t size_;
+    std::size_t capacity_;
+    bool borrowed_;
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "projectile.h"
+#include "slot_map.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+struct Flight;
+
+// Stable reference to a flight in a BallisticEngine
+typedef SlotHandle<Flight> FlightHandle;
+
+// Event-driven alternative to stepping every projectile every frame. Between
+// bounces a shell feels only gravity, so each flight is stored as the state it
+// had at its last bounce (or launch) plus that time, and its position at any
+// later time is the closed-form arc (flyProjectile). The next ground or wall
+// impact is solved for analytically (timeToGround, timeToWall) and queued;
+// advancing the clock only touches flights with an impact or expiry due, so the
+// work scales with the number of events rather than frames x projectiles.
+//
+// Flights do not collide with each other: that needs the stepped simulation.
+// Clock times are doubles so long runs keep sub-millisecond resolution;
+// per-flight elapsed times are floats, like a step.
+class BallisticEngine {
+public:
+    BallisticEngine() : now_(0.0), eventsProcessed_(0) {}
+
+    BallisticEngine(const BallisticEngine&) = delete;
+    BallisticEngine& operator=(const BallisticEngine&) = delete;
+
+    std::size_t size() const { return slots_.size(); }
+    double now() const { return now_; }
+    unsigned long long eventsProcessed() const { return eventsProcessed_; }
+    std::size_t pendingEvents() const { return events_.size(); }
+
+    // Adds a shell in the state `projectile` describes at the current time
+    FlightHandle launch(const Projectile& projectile) {
+        FlightHandle handle = slots_.insert();
+        startX_.push_back(projectile.position.x);
+        startY_.push_back(projectile.position.y);
+        velX_.push_back(projectile.velocity.x);
+        velY_.push_back(projectile.velocity.y);
+        radius_.push_back(projectile.radius);
+        startTime_.push_back(now_);
+        events_.push(Event{now_ - projectile.timeAlive + PROJECTILE_LIFETIME, handle, EventKind::Expire});
+        scheduleImpact(size() - 1, handle);
+        return handle;
+    }
+
+    // Moves the clock to `time` (never backwards), applying every bounce,
+    // settle and expiry due by then in time order. Returns the events applied.
+    std::size_t advanceTo(double time) {
+        std::size_t applied = 0;
+        while (!events_.empty() && events_.top().time <= time) {
+            Event event = events_.top();
+            events_.pop();
+            std::uint32_t dense = slots_.find(event.flight);
+            if (dense == FlightSlots::npos) {
+                continue; // the flight settled or expired first
+            }
+            apply(dense, event);
+            ++applied;
+        }
+        now_ = std::fmax(now_, time);
+        eventsProcessed_ += applied;
+        return applied;
+    }
+
+    // State of a flight at the current time, or false if it has ended
+    bool stateAt(FlightHandle handle, glm::vec2& position, glm::vec2& velocity) const {
+        std::uint32_t dense = slots_.find(handle);
+        if (dense == FlightSlots::npos) {
+            return false;
+        }
+        evaluate(dense, now_, position, velocity);
+        return true;
+    }
+
+    // Calls visit(position, radius) for every flight at the current time
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        forEach(0, size(), visit);
+    }
+
+    // Same for flights [begin, end) in dense order, so callers can split the work
+    template <typename Visit>
+    void forEach(std::size_t begin, std::size_t end, Visit visit) const {
+        for (std::size_t i = begin; i < end; ++i) {
+            glm::vec2 position;
+            glm::vec2 velocity;
+            evaluate(i, now_, position, velocity);
+            visit(position, radius_[i]);
+        }
+    }
+
+    // FNV-1a over every flight's stored state and the clock, so runs with the
+    // same inputs can be compared like ProjectileStore::hash
+    std::uint64_t hash() const {
+        std::uint64_t result = 14695981039346656037ull;
+        auto mix = [&result](const void* data, std::size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                result = (result ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        mix(&now_, sizeof(now_));
+        mix(startX_.data(), startX_.size() * sizeof(float));
+        mix(startY_.data(), startY_.size() * sizeof(float));
+        mix(velX_.data(), velX_.size() * sizeof(float));
+        mix(velY_.data(), velY_.size() * sizeof(float));
+        mix(radius_.data(), radius_.size() * sizeof(float));
+        mix(startTime_.data(), startTime_.size() * sizeof(double));
+        return result;
+    }
+
+    void clear() {
+        slots_.clear();
+        startX_.clear();
+        startY_.clear();
+        velX_.clear();
+        velY_.clear();
+        radius_.clear();
+        startTime_.clear();
+        events_ = EventQueue();
+    }
+
+private:
+    typedef SlotMap<Flight> FlightSlots;
+
+    enum class EventKind : std::uint8_t { Ground, Wall, Expire };
+
+    struct Event {
+        double time;
+        FlightHandle flight;
+        EventKind kind;
+    };
+
+    // Earliest event on top; ties go to the older slot so the order is reproducible
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            if (a.time != b.time) {
+                return a.time > b.time;
+            }
+            return a.flight.index > b.flight.index;
+        }
+    };
+
+    typedef std::priority_queue<Event, std::vector<Event>, Later> EventQueue;
+
+    void evaluate(std::size_t i, double time, glm::vec2& position, glm::vec2& velocity) const {
+        float px = startX_[i];
+        float py = startY_[i];
+        float vy = velY_[i];
+        flyProjectile(px, py, velX_[i], vy, static_cast<float>(time - startTime_[i]));
+        position = glm::vec2(px, py);
+        velocity = glm::vec2(velX_[i], vy);
+    }
+
+    void scheduleImpact(std::size_t i, FlightHandle handle) {
+        float groundTime = timeToGround(startY_[i] - radius_[i], velY_[i]);
+        float wallTime = timeToWall(startX_[i], velX_[i], radius_[i]);
+        EventKind kind = groundTime <= wallTime ? EventKind::Ground : EventKind::Wall;
+        events_.push(Event{startTime_[i] + std::fmin(groundTime, wallTime), handle, kind});
+    }
+
+    void apply(std::size_t i, const Event& event) {
+        if (event.kind == EventKind::Expire) {
+            erase(i);
+            return;
+        }
+
+        // Rebase the flight on its state at the impact
+        float px = startX_[i];
+        float py = startY_[i];
+        float vx = velX_[i];
+        float vy = velY_[i];
+        flyProjectile(px, py, vx, vy, static_cast<float>(event.time - startTime_[i]));
+        if (event.kind == EventKind::Ground) {
+            if (!bounceOffGround(py, vx, vy, radius_[i])) {
+                erase(i);
+                return;
+            }
+        } else {
+            bounceOffWall(px, vx, radius_[i]);
+        }
+        startX_[i] = px;
+        startY_[i] = py;
+        velX_[i] = vx;
+        velY_[i] = vy;
+        startTime_[i] = event.time;
+        scheduleImpact(i, event.flight);
+    }
+
+    // Mirrors SlotMap::eraseAt: the last flight moves into the hole. Its queued
+    // events still find it through its handle.
+    void erase(std::size_t i) {
+        slots_.eraseAt(i);
+        moveLastInto(startX_, i);
+        moveLastInto(startY_, i);
+        moveLastInto(velX_, i);
+        moveLastInto(velY_, i);
+        moveLastInto(radius_, i);
+        moveLastInto(startTime_, i);
+    }
+
+    template <typename T>
+    static void moveLastInto(std::vector<T>& column, std::size_t i) {
+        column[i] = column.back();
+        column.pop_back();
+    }
+
+    double now_;
+    unsigned long long eventsProcessed_;
+    FlightSlots slots_;
+    // State at the last bounce (or launch), at startTime_
+    std::vector<float> startX_;
+    std::vector<float> startY_;
+    std::vector<float> velX_;
+    std::vector<float> velY_;
+    std::vector<float> radius_;
+    std::vector<double> startTime_;
+    EventQueue events_;
+};
@@ -0,0 +1,1067 @@
+// Simulation microbenchmarks; no window or GL context needed.
+//   g++ -std=c++17 -O3 -fno-trapping-math -pthread bench.cpp -o cannon_bench
+//   ./cannon_bench [--max-count N] [--filter SUBSTRING] [--out FILE] [--fixture SNAPSHOT]
+// Progress goes to stderr; results are written as JSON (stdout by default) so
+// runs can be diffed across releases.
+#include "projectile.h"
+#include "projectile_store.h"
+#include "projectile_simd.h"
+#include "job_system.h"
+#include "circle_instances.h"
+#include "collision_grid.h"
+#include "collision_simd.h"
+#include "ballistic_engine.h"
+#include "timing_wheel.h"
+#include "fixed_projectile.h"
+#include "world_snapshot.h"
+#include "rewind_buffer.h"
+#include "trajectory_export.h"
+#include "firing_solution.h"
+#include "firing_table.h"
+#include "dispersion.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+const std::size_t UPDATE_GRAIN = 16384;
+const float STEP_TIME = 1.0f / 120.0f;
+
+// Each measurement runs for at least this long and at least MIN_BENCH_REPS times
+const double MIN_BENCH_SECONDS = 0.2;
+const int MIN_BENCH_REPS = 3;
+
+// Shells are refilled after this many update steps (one simulated second) so
+// the mix of flying, bouncing and settled shells stays representative
+const int STEPS_PER_REFILL = 120;
+
+struct BenchResult {
+    std::string name;
+    std::string variant;
+    std::size_t count;
+    unsigned threads;
+    int reps;
+    double meanSeconds;
+    double bestSeconds;
+    std::string note;
+};
+
+struct BenchOptions {
+    std::size_t maxCount = 10000000;
+    std::string filter;
+    std::string outPath;
+    std::string fixturePath;
+};
+
+class BenchReport {
+public:
+    explicit BenchReport(const BenchOptions& options) : options_(options) {}
+
+    const BenchOptions& options() const { return options_; }
+
+    bool wants(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    // 1, 10, 100, ... up to --max-count
+    std::vector<std::size_t> counts(std::size_t minimum = 1) const {
+        std::vector<std::size_t> result;
+        for (std::size_t count = 1; count <= options_.maxCount; count *= 10) {
+            if (count >= minimum) {
+                result.push_back(count);
+            }
+        }
+        return result;
+    }
+
+    void add(const BenchResult& result) {
+        std::cerr << result.name << "/" << result.variant << " n=" << result.count << " t=" << result.threads
+                  << ": " << result.meanSeconds * 1e6 << " us/op, "
+                  << (result.count / result.meanSeconds) / 1e6 << " M items/s" << std::endl;
+        results_.push_back(result);
+    }
+
+    void writeJson(std::ostream& out, const std::string& simd) const {
+        out << "{\n  \"suite\": \"cannon_bench\",\n  \"simd\": \"" << simd << "\",\n"
+            << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "  \"results\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            out << "    {\"name\": \"" << r.name << "\", \"variant\": \"" << r.variant << "\", \"count\": " << r.count
+                << ", \"threads\": " << r.threads << ", \"reps\": " << r.reps
+                << ", \"mean_ns\": " << r.meanSeconds * 1e9 << ", \"best_ns\": " << r.bestSeconds * 1e9
+                << ", \"ns_per_item\": " << r.meanSeconds * 1e9 / r.count
+                << ", \"items_per_second\": " << r.count / r.meanSeconds;
+            if (!r.note.empty()) {
+                out << ", \"note\": \"" << r.note << "\"";
+            }
+            out << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    BenchOptions options_;
+    std::vector<BenchResult> results_;
+};
+
+// Times run() until MIN_BENCH_SECONDS of measured time have passed. setup() runs
+// untimed before the first rep and then before every `setupEvery`-th rep.
+BenchResult measure(const std::string& name, const std::string& variant, std::size_t count, unsigned threads,
+                    const std::function<void()>& setup, const std::function<void()>& run, int setupEvery) {
+    BenchResult result{name, variant, count, threads, 0, 0.0, 1e30, ""};
+    double total = 0.0;
+    while (total < MIN_BENCH_SECONDS || result.reps < MIN_BENCH_REPS) {
+        if (result.reps % setupEvery == 0) {
+            setup();
+        }
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        total += seconds;
+        result.bestSeconds = std::min(result.bestSeconds, seconds);
+        ++result.reps;
+    }
+    result.meanSeconds = total / result.reps;
+    return result;
+}
+
+// Deterministic spread of shells in flight across the whole window
+Projectile randomProjectile(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    return Projectile(glm::vec2(unit(rng) * WINDOW_WIDTH, 5.0f + unit(rng) * WINDOW_HEIGHT),
+                      glm::vec2(unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 100.0f), 5.0f);
+}
+
+void fillProjectiles(ProjectileStore& store, std::size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    store.clear();
+    store.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        store.push(randomProjectile(rng));
+    }
+}
+
+// FNV-1a over every column, to check results do not depend on thread count
+std::uint64_t hashProjectiles(const ProjectileStore& store) {
+    std::uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, std::size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+    };
+    std::size_t n = store.size();
+    mix(store.posX(), n * sizeof(float));
+    mix(store.posY(), n * sizeof(float));
+    mix(store.velX(), n * sizeof(float));
+    mix(store.velY(), n * sizeof(float));
+    mix(store.timeAlive(), n * sizeof(float));
+    mix(store.active(), n);
+    return hash;
+}
+
+// Projectile::update throughput: the original array-of-structs member loop and
+// every span kernel this CPU can run, single-threaded
+void benchUpdate(BenchReport& report) {
+    if (!report.wants("update")) {
+        return;
+    }
+    for (std::size_t count : report.counts()) {
+        std::vector<Projectile> aos;
+        report.add(measure("update", "aos_member", count, 1,
+            [&] {
+                std::mt19937 rng(1);
+                aos.clear();
+                for (std::size_t i = 0; i < count; ++i) {
+                    aos.push_back(randomProjectile(rng));
+                }
+            },
+            [&] {
+                for (auto& projectile : aos) {
+                    if (projectile.active) {
+                        projectile.update(STEP_TIME);
+                    }
+                }
+            }, STEPS_PER_REFILL));
+        std::vector<Projectile>().swap(aos);
+
+        ProjectileStore store;
+        for (int level = 0; level <= static_cast<int>(detectSimdLevel()); ++level) {
+            SimdLevel simd = static_cast<SimdLevel>(level);
+            ProjectileUpdateKernel kernel = selectUpdateKernel(simd);
+            BenchResult result = measure("update", simdLevelName(simd), count, 1,
+                [&] { fillProjectiles(store, count, 1); },
+                [&] { kernel(store.span(), STEP_TIME); }, STEPS_PER_REFILL);
+            if (count == report.counts().front()) {
+                float error = compareUpdateKernelWithScalar(kernel);
+                result.note = "max_error_vs_scalar=" + std::to_string(error);
+            }
+            report.add(result);
+        }
+    }
+}
+
+// Parallel integration from 1 thread up to every hardware thread, with a check
+// that the final state is identical for every thread count
+void benchParallelUpdate(BenchReport& report) {
+    if (!report.wants("update_parallel")) {
+        return;
+    }
+    ProjectileUpdateKernel kernel = selectUpdateKernel(detectSimdLevel());
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (std::size_t count : report.counts(100000)) {
+        ProjectileStore store;
+        std::uint64_t expectedHash = 0;
+        for (unsigned threads : threadCounts) {
+            JobSystem jobs(threads);
+            auto step = [&] {
+                ProjectileSpan span = store.span();
+                jobs.parallelFor(0, span.count, UPDATE_GRAIN, [&](std::size_t begin, std::size_t end) {
+                    kernel(span.subspan(begin, end - begin), STEP_TIME);
+                });
+            };
+
+            // Fixed number of steps from the same start for the determinism check
+            fillProjectiles(store, count, 1);
+            for (int i = 0; i < 20; ++i) {
+                step();
+            }
+            std::uint64_t hash = hashProjectiles(store);
+            if (threads == 1) {
+                expectedHash = hash;
+            }
+
+            BenchResult result = measure("update_parallel", simdLevelName(detectSimdLevel()), count, threads,
+                [&] { fillProjectiles(store, count, 1); }, step, STEPS_PER_REFILL);
+            result.note = hash == expectedHash ? "deterministic" : "MISMATCH_vs_1_thread";
+            report.add(result);
+        }
+    }
+}
+
+// eraseIf compaction with the main loop's predicate, for several death rates
+void benchCompaction(BenchReport& report) {
+    if (!report.wants("compact")) {
+        return;
+    }
+    struct Case { const char* variant; int deadPerThousand; };
+    const Case cases[] = {{"none_dead", 0}, {"1pct_dead", 10}, {"50pct_dead", 500}};
+    auto dead = [](const ProjectileStore::ConstRef& p) { return !p.active() || p.timeAlive() > 10.0f; };
+
+    for (std::size_t count : report.counts()) {
+        ProjectileStore store;
+        for (const Case& c : cases) {
+            report.add(measure("compact", c.variant, count, 1,
+                [&] {
+                    fillProjectiles(store, count, 1);
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if ((i * 7919) % 1000 < static_cast<std::size_t>(c.deadPerThousand)) {
+                            Projectile projectile = store.get(i);
+                            projectile.active = false;
+                            store.set(i, projectile);
+                        }
+                    }
+                },
+                [&] { store.eraseIf(dead); }, c.deadPerThousand == 0 ? 1000000 : 1));
+        }
+    }
+}
+
+// fireProjectile bursts: launch math plus store append, into a fresh store
+// (includes column growth) and into a cleared one (capacity already there)
+void benchSpawn(BenchReport& report) {
+    if (!report.wants("spawn")) {
+        return;
+    }
+    glm::vec2 cannonPosition(50.0f, 50.0f);
+    for (std::size_t count : report.counts()) {
+        auto burst = [&](ProjectileStore& store) {
+            for (std::size_t i = 0; i < count; ++i) {
+                store.push(launchProjectile(cannonPosition, 10.0f + (i % 80), 10.0f + (i % 90)));
+            }
+        };
+        report.add(measure("spawn", "cold", count, 1, [] {},
+            [&] {
+                ProjectileStore store;
+                burst(store);
+            }, 1));
+
+        ProjectileStore warm;
+        burst(warm);
+        report.add(measure("spawn", "warm", count, 1, [&] { warm.clear(); }, [&] { burst(warm); }, 1));
+    }
+}
+
+// CPU-side cost of submitting projectiles for drawing: the instance fill the
+// instanced renderer maps into its VBO, and the per-vertex trig the immediate
+// path computes before each glVertex2f (vertices land in a scratch array; the
+// driver's own per-call cost is not included)
+void benchDrawSubmission(BenchReport& report) {
+    if (!report.wants("draw")) {
+        return;
+    }
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    JobSystem jobs(threads);
+    for (std::size_t count : report.counts()) {
+        ProjectileStore store;
+        fillProjectiles(store, count, 1);
+
+        std::vector<CircleInstance> instances(count);
+        report.add(measure("draw", "instance_fill", count, threads, [] {},
+            [&] { fillProjectileInstances(store, 0.5f, instances.data(), jobs); }, 1));
+        std::vector<CircleInstance>().swap(instances);
+
+        if (count > 1000000) {
+            continue; // 38 vertices per shell; the largest sizes only measure memory
+        }
+        std::vector<glm::vec2> vertices(count * 38);
+        report.add(measure("draw", "immediate_vertices", count, 1, [] {},
+            [&] {
+                glm::vec2* out = vertices.data();
+                for (auto projectile : store) {
+                    if (projectile.active()) {
+                        glm::vec2 position = projectile.interpolatedPosition(0.5f);
+                        float radius = projectile.radius();
+                        *out++ = position;
+                        for (int i = 0; i <= 360; i += 10) {
+                            float radian = i * PI / 180.0f;
+                            *out++ = glm::vec2(position.x + radius * cos(radian),
+                                               position.y + radius * sin(radian));
+                        }
+                    }
+                }
+            }, 1));
+    }
+}
+
+// One collision step (grid build, pair finding, narrowphase, response) over
+// shells spread at different densities, at one thread and at every hardware
+// thread. Cells are 10 units (two radii) wide. The default counts include 1M,
+// well past the COLLISION_SHELL_LIMIT where the simulator turns collisions off.
+void benchCollisions(BenchReport& report) {
+    if (!report.wants("collide")) {
+        return;
+    }
+    struct Distribution { const char* variant; float shellsPerCell; bool clustered; };
+    const Distribution distributions[] = {
+        {"sparse", 0.25f, false}, {"dense", 2.0f, false}, {"clustered", 0.25f, true}};
+    const float cell = 10.0f;
+
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts(1, 1u);
+    if (maxThreads > 1) {
+        threadCounts.push_back(maxThreads);
+    }
+    for (std::size_t count : report.counts(1000)) {
+        ProjectileStore store;
+        ProjectileCollisions collisions;
+        collisions.setNarrowphase(selectNarrowphaseKernel(detectSimdLevel()));
+        for (const Distribution& d : distributions) {
+            float side = std::sqrt(count / d.shellsPerCell) * cell;
+            auto fill = [&] {
+                std::mt19937 rng(7);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                std::normal_distribution<float> spread(0.0f, side / 32.0f);
+                glm::vec2 centres[16];
+                for (auto& centre : centres) {
+                    centre = glm::vec2(unit(rng) * side, unit(rng) * side);
+                }
+                store.clear();
+                store.reserve(count);
+                for (std::size_t i = 0; i < count; ++i) {
+                    glm::vec2 position = d.clustered ? centres[i % 16] + glm::vec2(spread(rng), spread(rng))
+                                                     : glm::vec2(unit(rng) * side, unit(rng) * side);
+                    glm::vec2 velocity(unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 100.0f);
+                    store.push(Projectile(position, velocity, 5.0f));
+                }
+            };
+            std::uint64_t expectedHash = 0;
+            for (unsigned threads : threadCounts) {
+                JobSystem jobs(threads);
+                fill();
+                collisions.step(store.span(), jobs);
+                std::uint64_t hash = hashProjectiles(store);
+                if (threads == 1) {
+                    expectedHash = hash;
+                }
+                BenchResult result = measure("collide", d.variant, count, threads, fill,
+                    [&] { collisions.step(store.span(), jobs); }, 1);
+                result.note = "pairs=" + std::to_string(collisions.pairCount()) +
+                              " contacts=" + std::to_string(collisions.contactCount()) +
+                              (hash == expectedHash ? " deterministic" : " MISMATCH_vs_1_thread");
+                report.add(result);
+            }
+        }
+    }
+}
+
+// Narrowphase alone over the candidate pairs of uniformly spread shells at two
+// per cell, scalar and every SIMD width this CPU can run. Items are pairs.
+void benchNarrowphase(BenchReport& report) {
+    if (!report.wants("narrowphase")) {
+        return;
+    }
+    JobSystem jobs(1);
+    for (std::size_t count : report.counts(1000)) {
+        ProjectileStore store;
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        float side = std::sqrt(count / 2.0f) * 10.0f;
+        for (std::size_t i = 0; i < count; ++i) {
+            store.push(Projectile(glm::vec2(unit(rng) * side, unit(rng) * side), glm::vec2(0.0f), 5.0f));
+        }
+        CollisionGrid grid;
+        AlignedArray<CollisionPair> pairs;
+        AlignedArray<Contact> contacts;
+        grid.build(store.span());
+        grid.findPairs(jobs, pairs);
+
+        for (SimdLevel simd : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (simd > detectSimdLevel()) {
+                break;
+            }
+            NarrowphaseKernel kernel = selectNarrowphaseKernel(simd);
+            BenchResult result = measure("narrowphase", simdLevelName(simd), pairs.size(), 1, [] {},
+                [&] { kernel(store.span(), pairs.data(), pairs.size(), contacts); }, 1);
+            result.note = "contacts=" + std::to_string(contacts.size());
+            if (count == report.counts(1000).front()) {
+                result.note += " max_error_vs_scalar=" + std::to_string(compareNarrowphaseWithScalar(kernel));
+            }
+            report.add(result);
+        }
+    }
+}
+
+// One simulated second at 60 frames per second: the stepped update against the
+// event-driven engine, which only does work at bounces, settles and expiries
+void benchBallistic(BenchReport& report) {
+    if (!report.wants("ballistic")) {
+        return;
+    }
+    const int frames = 60;
+    const float frameTime = 1.0f / frames;
+    ProjectileUpdateKernel kernel = selectUpdateKernel(detectSimdLevel());
+    for (std::size_t count : report.counts(1000)) {
+        ProjectileStore store;
+        report.add(measure("ballistic", "stepped", count, 1,
+            [&] { fillProjectiles(store, count, 1); },
+            [&] {
+                for (int frame = 0; frame < frames; ++frame) {
+                    kernel(store.span(), frameTime);
+                }
+            }, 1));
+
+        BallisticEngine engine;
+        BenchResult result = measure("ballistic", "events", count, 1,
+            [&] {
+                std::mt19937 rng(1);
+                engine.clear();
+                for (std::size_t i = 0; i < count; ++i) {
+                    engine.launch(randomProjectile(rng));
+                }
+            },
+            [&] {
+                double start = engine.now();
+                for (int frame = 1; frame <= frames; ++frame) {
+                    engine.advanceTo(start + frame * double(frameTime));
+                }
+            }, 1);
+        result.note = "events_per_second=" + std::to_string(engine.eventsProcessed() / result.reps);
+        report.add(result);
+    }
+}
+
+// Lifetime expiry over ten simulated seconds at 60 steps per second: the old
+// per-frame timeAlive scan against one timing-wheel timer per shell, each
+// scheduled, carried through the levels and fired
+void benchTimers(BenchReport& report) {
+    if (!report.wants("timers")) {
+        return;
+    }
+    const int steps = 600;
+    for (std::size_t count : report.counts(1000)) {
+        ProjectileStore store;
+        std::size_t expired = 0;
+        report.add(measure("timers", "lifetime_scan", count, 1,
+            [&] { fillProjectiles(store, count, 1); },
+            [&] {
+                const float* timeAlive = store.timeAlive();
+                for (int step = 1; step <= steps; ++step) {
+                    float limit = PROJECTILE_LIFETIME - step * (1.0f / 60.0f);
+                    for (std::size_t i = 0; i < count; ++i) {
+                        expired += timeAlive[i] > limit;
+                    }
+                }
+            }, 1));
+
+        TimingWheel<std::uint32_t> wheel;
+        std::vector<unsigned long long> due(count);
+        BenchResult result = measure("timers", "wheel", count, 1,
+            [&] {
+                std::mt19937 rng(1);
+                std::uniform_int_distribution<int> pick(1, steps);
+                for (auto& tick : due) {
+                    tick = pick(rng);
+                }
+            },
+            [&] {
+                unsigned long long start = wheel.now();
+                for (std::size_t i = 0; i < count; ++i) {
+                    wheel.schedule(start + due[i], static_cast<std::uint32_t>(i));
+                }
+                for (int step = 1; step <= steps; ++step) {
+                    wheel.advanceTo(start + step, [&](std::uint32_t) { ++expired; });
+                }
+            }, 1);
+        result.note = "expired=" + std::to_string(expired);
+        report.add(result);
+    }
+}
+
+// Fixed-point shells in their own columns, filled from the same random shells as the float store
+template <typename F>
+struct FixedBenchColumns {
+    std::vector<F> posX, posY, velX, velY, radius;
+    std::vector<std::uint8_t> active;
+
+    void fill(std::size_t count, unsigned seed) {
+        std::mt19937 rng(seed);
+        for (auto* column : {&posX, &posY, &velX, &velY, &radius}) {
+            column->resize(count);
+        }
+        active.assign(count, 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            Projectile projectile = randomProjectile(rng);
+            posX[i] = F::fromFloat(projectile.position.x);
+            posY[i] = F::fromFloat(projectile.position.y);
+            velX[i] = F::fromFloat(projectile.velocity.x);
+            velY[i] = F::fromFloat(projectile.velocity.y);
+            radius[i] = F::fromFloat(projectile.radius);
+        }
+    }
+
+    FixedProjectileSpan<F> span() {
+        return FixedProjectileSpan<F>{posX.data(), posY.data(), velX.data(), velY.data(),
+                                      radius.data(), active.data(), active.size()};
+    }
+};
+
+template <typename F>
+BenchResult measureFixedUpdate(const std::string& variant, std::size_t count) {
+    FixedBenchColumns<F> columns;
+    FixedConstants<F> constants;
+    F deltaTime = F::fromFloat(STEP_TIME);
+    return measure("fixed", variant, count, 1,
+        [&] { columns.fill(count, 1); },
+        [&] { updateFixedProjectiles(columns.span(), deltaTime, constants); }, STEPS_PER_REFILL);
+}
+
+// Cost of the deterministic fixed-point update against the float scalar kernel
+// on the same shells, single-threaded
+void benchFixed(BenchReport& report) {
+    if (!report.wants("fixed")) {
+        return;
+    }
+    for (std::size_t count : report.counts(100)) {
+        ProjectileStore store;
+        report.add(measure("fixed", "float_scalar", count, 1,
+            [&] { fillProjectiles(store, count, 1); },
+            [&] { updateProjectilesScalar(store.span(), STEP_TIME); }, STEPS_PER_REFILL));
+        report.add(measureFixedUpdate<Q16_16>("q16_16", count));
+        report.add(measureFixedUpdate<Q32_32>("q32_32", count));
+    }
+}
+
+// World snapshots: saving, mapping (header, directory and image checks),
+// restoring into a store (which adopts the mapping), and one update step run
+// in place on a fresh mapping, which pays for reading the pages in. The file
+// goes in the working directory.
+void benchSnapshot(BenchReport& report) {
+    if (!report.wants("snapshot")) {
+        return;
+    }
+    const std::string path = "cannon_bench.cnsn";
+    for (std::size_t count : report.counts(1000)) {
+        ProjectileStore store;
+        TimingWheel<ProjectileHandle> timers;
+        SimulationClock clock(1.0 / STEP_TIME, 8);
+        float angle = 45.0f;
+        float power = 50.0f;
+        glm::vec2 position(50.0f, 50.0f);
+        bool collisions = true;
+        SimulationState state{store, timers, clock, angle, power, position, collisions};
+        fillProjectiles(store, count, 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            timers.schedule(1 + i % 1200, store.handleAt(i));
+        }
+        std::uint64_t expected = store.hash();
+
+        report.add(measure("snapshot", "save", count, 1, [] {}, [&] { saveSnapshot(path, state); }, 1));
+
+        MappedSnapshot snapshot;
+        report.add(measure("snapshot", "map", count, 1, [] {}, [&] { snapshot.open(path); }, 1));
+
+        BenchResult result = measure("snapshot", "restore", count, 1, [] {},
+            [&] {
+                MappedSnapshot mapped;
+                mapped.open(path);
+                mapped.restore(state);
+            }, 1);
+        result.note = store.hash() == expected && timers.size() == count ? "round_trip=ok" : "round_trip=MISMATCH";
+        report.add(result);
+
+        report.add(measure("snapshot", "map_and_update", count, 1, [] {},
+            [&] {
+                MappedSnapshot mapped;
+                mapped.open(path);
+                updateProjectilesScalar(mapped.span(), STEP_TIME);
+            }, 1));
+        std::remove(path.c_str());
+    }
+}
+
+// Rewind history: capturing a keyframe, capturing a delta one step after it,
+// and rewinding to each, on one thread and on all of them. Stops at 1M shells,
+// where a keyframe alone is ~50 MB.
+void benchRewind(BenchReport& report) {
+    if (!report.wants("rewind")) {
+        return;
+    }
+    std::vector<unsigned> threadCounts(1, 1);
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (maxThreads > 1) {
+        threadCounts.push_back(maxThreads);
+    }
+    for (std::size_t count : report.counts(1000)) {
+        if (count > 1000000) {
+            break;
+        }
+        ProjectileStore store;
+        TimingWheel<ProjectileHandle> timers;
+        SimulationClock clock(1.0 / STEP_TIME, 8);
+        float angle = 45.0f;
+        float power = 50.0f;
+        glm::vec2 position(50.0f, 50.0f);
+        bool collisions = true;
+        SimulationState state{store, timers, clock, angle, power, position, collisions};
+        RewindBuffer history;
+        history.setBudget(count * 256);
+
+        for (unsigned threads : threadCounts) {
+            JobSystem jobs(threads);
+
+            // A fresh world and history, captured as a keyframe and then `deltas` steps on
+            auto prepare = [&](int deltas) {
+                fillProjectiles(store, count, 1);
+                clock.restore(0, 0.0, 0.0);
+                timers.reset(0);
+                for (std::size_t i = 0; i < count; ++i) {
+                    timers.schedule(1 + i % 1200, store.handleAt(i));
+                }
+                history.clear();
+                for (int step = 0; step <= deltas; ++step) {
+                    if (step > 0) {
+                        clock.advance(STEP_TIME);
+                        updateProjectilesScalar(store.span(), STEP_TIME);
+                    }
+                    history.capture(state, jobs);
+                }
+            };
+
+            report.add(measure("rewind", "capture_keyframe", count, threads,
+                [&] { prepare(0); history.clear(); },
+                [&] { history.capture(state, jobs); }, 1));
+            report.add(measure("rewind", "capture_delta", count, threads,
+                [&] {
+                    prepare(0);
+                    clock.advance(STEP_TIME);
+                    updateProjectilesScalar(store.span(), STEP_TIME);
+                },
+                [&] { history.capture(state, jobs); }, 1));
+
+            std::uint64_t expected = 0;
+            BenchResult result = measure("rewind", "rewind_keyframe", count, threads,
+                [&] {
+                    prepare(0);
+                    expected = store.hash();
+                    clock.advance(STEP_TIME);
+                    updateProjectilesScalar(store.span(), STEP_TIME);
+                },
+                [&] { history.rewindTo(0.0, state, jobs); }, 1);
+            result.note = store.hash() == expected && timers.size() == count ? "round_trip=ok" : "round_trip=MISMATCH";
+            report.add(result);
+            // The store still holds the delta's handles; rewinding from a
+            // frame that fired or expired shells also reassigns the slot map
+            report.add(measure("rewind", "rewind_delta", count, threads,
+                [&] { prepare(1); },
+                [&] { history.rewindTo(clock.simulatedTime(), state, jobs); }, 1));
+            report.add(measure("rewind", "rewind_delta_reassign", count, threads,
+                [&] {
+                    prepare(1);
+                    store.eraseAt(0);
+                },
+                [&] { history.rewindTo(clock.simulatedTime(), state, jobs); }, 1));
+        }
+    }
+}
+
+// Trajectory export: the main thread's cost of queuing one step ("sample"; the
+// exporter is reopened before its blocks run out, so nothing is dropped), and
+// end-to-end throughput of 16 steps to a file in the working directory, closing
+// included ("sustained"). Stops at 1M shells, where that file is ~450 MB.
+void benchExport(BenchReport& report) {
+    if (!report.wants("export")) {
+        return;
+    }
+    const std::string path = "cannon_bench.cntr";
+    const int sustainedSteps = 16;
+    for (std::size_t count : report.counts(1000)) {
+        if (count > 1000000) {
+            break;
+        }
+        ProjectileStore store;
+        fillProjectiles(store, count, 1);
+        TrajectoryExporter exporter;
+        unsigned long long step = 0;
+
+        // Steps that fit in the exporter's blocks before it has to drop any
+        int queuedSteps = static_cast<int>(TrajectoryExporter::BLOCKS * std::min(TRAJECTORY_BLOCK_STEPS,
+            TrajectoryExporter::BLOCK_SAMPLES / count));
+        if (count > TrajectoryExporter::BLOCK_SAMPLES) {
+            queuedSteps = static_cast<int>(TrajectoryExporter::BLOCKS * TrajectoryExporter::BLOCK_SAMPLES / count);
+        }
+        unsigned long long dropped = 0;
+        BenchResult result = measure("export", "sample", count, 1,
+            [&] {
+                dropped += exporter.droppedSamples();
+                exporter.close();
+                exporter.open(path, STEP_TIME, false);
+            },
+            [&] { exporter.sample(++step, store); }, std::max(queuedSteps - 1, 1));
+        dropped += exporter.droppedSamples();
+        exporter.close();
+        result.note = "dropped=" + std::to_string(dropped);
+        report.add(result);
+
+        report.add(measure("export", "sustained", count * sustainedSteps, 1, [] {},
+            [&] {
+                exporter.open(path, STEP_TIME, true);
+                for (int i = 0; i < sustainedSteps; ++i) {
+                    exporter.sample(++step, store);
+                }
+                exporter.close();
+            }, 1));
+        std::remove(path.c_str());
+    }
+}
+
+// Whether some angle, scanned every 0.05 degrees, aims a direct shot through
+// `target` within the cannon's power and the shell's lifetime, from the same
+// closed form the solver uses
+bool directShotExists(glm::vec2 cannon, glm::vec2 target) {
+    float x = target.x - cannon.x;
+    float y = target.y - cannon.y;
+    if (target.y < SHELL_RADIUS || target.x > WINDOW_WIDTH - SHELL_RADIUS) {
+        return false;
+    }
+    for (int step = 1; step < 1800; ++step) {
+        float angle = step * 0.05f * PI / 180.0f;
+        float c = std::cos(angle);
+        float s = std::sin(angle);
+        float u = x - BARREL_LENGTH * c;
+        float w = x * s - y * c;
+        if (u <= 0.0f || w <= 0.0f) {
+            continue;
+        }
+        float power2 = GRAVITY * u * u / (2.0f * c * w);
+        float time2 = 2.0f * w / (GRAVITY * c);
+        if (power2 >= MIN_CANNON_POWER * MIN_CANNON_POWER && power2 <= MAX_CANNON_POWER * MAX_CANNON_POWER &&
+            time2 <= PROJECTILE_LIFETIME * PROJECTILE_LIFETIME) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Firing solutions for targets spread over the window, from 1 thread up to
+// every hardware thread. "sweep" solves a grid of targets 4 px apart and notes
+// how many of those an angle scan reaches directly the solver calls
+// unreachable (misses=0 when it finds them all).
+void benchFiring(BenchReport& report) {
+    if (!report.wants("firing")) {
+        return;
+    }
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    FiringSolver solver(glm::vec2(50.0f, 50.0f));
+    for (std::size_t count : report.counts(1)) {
+        if (count > 1000000) {
+            break;
+        }
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<glm::vec2> targets(count);
+        for (glm::vec2& target : targets) {
+            target = glm::vec2(unit(rng) * WINDOW_WIDTH, unit(rng) * WINDOW_HEIGHT);
+        }
+        std::vector<FiringSolution> solutions(count);
+        for (unsigned threads : threadCounts) {
+            JobSystem jobs(threads);
+            BenchResult result = measure("firing", "batch", count, threads, [] {},
+                [&] { solver.solve(jobs, targets.data(), count, solutions.data()); }, 1);
+            std::size_t reachable = std::count_if(solutions.begin(), solutions.end(),
+                [](const FiringSolution& solution) { return solution.path != FiringPath::Unreachable; });
+            result.note = "reachable=" + std::to_string(reachable);
+            report.add(result);
+        }
+    }
+
+    std::vector<glm::vec2> grid;
+    for (int y = 2; y < WINDOW_HEIGHT; y += 4) {
+        for (int x = 2; x < WINDOW_WIDTH; x += 4) {
+            grid.push_back(glm::vec2(x, y));
+        }
+    }
+    std::vector<FiringSolution> solutions(grid.size());
+    BenchResult result = measure("firing", "sweep", grid.size(), 1, [] {},
+        [&] { solver.solveRange(grid.data(), grid.size(), solutions.data()); }, 1);
+    std::size_t scanned = 0;
+    std::size_t misses = 0;
+    for (std::size_t i = 0; i < grid.size(); ++i) {
+        if (directShotExists(glm::vec2(50.0f, 50.0f), grid[i])) {
+            ++scanned;
+            misses += solutions[i].path == FiringPath::Unreachable;
+        }
+    }
+    result.note = "scanned=" + std::to_string(scanned) + " misses=" + std::to_string(misses);
+    report.add(result);
+}
+
+// Firing tables: building the whole grid at each thread count, mapping a built
+// table (the physics hash included), and lookups and range inversions at
+// random aims
+void benchFiringTable(BenchReport& report) {
+    if (!report.wants("firing_table")) {
+        return;
+    }
+    const std::string path = "cannon_bench.cnft";
+    const glm::vec2 cannon(50.0f, 50.0f);
+    const double stepSeconds = 1.0 / 60.0;
+    const std::uint64_t physicsHash = firingPhysicsHash(cannon, stepSeconds);
+    const std::size_t shots = std::size_t(FIRING_TABLE_ANGLES) * FIRING_TABLE_POWERS;
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        JobSystem jobs(threads);
+        report.add(measure("firing_table", "build", shots, threads, [] {},
+            [&] { FiringTable::build(path, jobs, cannon, stepSeconds, physicsHash); }, 1));
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+
+    FiringTable table;
+    report.add(measure("firing_table", "open", shots, 1, [] {},
+        [&] { table.open(path, firingPhysicsHash(cannon, stepSeconds)); }, 1));
+    if (!table.isOpen()) {
+        std::remove(path.c_str());
+        return;
+    }
+    for (std::size_t count : report.counts(1)) {
+        if (count > 1000000) {
+            break;
+        }
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> angles(MIN_CANNON_ANGLE, MAX_CANNON_ANGLE);
+        std::uniform_real_distribution<float> powers(MIN_CANNON_POWER, MAX_CANNON_POWER);
+        std::uniform_real_distribution<float> ranges(0.0f, WINDOW_WIDTH - cannon.x);
+        std::vector<glm::vec2> aims(count);
+        std::vector<float> targetRanges(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            aims[i] = glm::vec2(angles(rng), powers(rng));
+            targetRanges[i] = ranges(rng);
+        }
+        float checksum = 0.0f;
+        BenchResult result = measure("firing_table", "lookup", count, 1, [] {},
+            [&] {
+                checksum = 0.0f;
+                for (const glm::vec2& aim : aims) {
+                    checksum += table.lookup(aim.x, aim.y).range;
+                }
+            }, 1);
+        result.note = "checksum=" + std::to_string(checksum);
+        report.add(result);
+
+        std::size_t reachable = 0;
+        result = measure("firing_table", "aim_for_range", count, 1, [] {},
+            [&] {
+                reachable = 0;
+                for (std::size_t i = 0; i < count; ++i) {
+                    float power;
+                    reachable += table.aimForRange(aims[i].x, targetRanges[i], power);
+                }
+            }, 1);
+        result.note = "reachable=" + std::to_string(reachable);
+        report.add(result);
+    }
+    table.close();
+    std::remove(path.c_str());
+}
+
+// Monte Carlo dispersion of one aim at each thread count. Every shot flies
+// Projectile::update until it lands; stops at 1M shots.
+void benchDispersion(BenchReport& report) {
+    if (!report.wants("dispersion")) {
+        return;
+    }
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    DispersionSetup setup;
+    setup.angle = 35.0f;
+    DispersionAnalysis analysis(glm::vec2(50.0f, 50.0f), 1.0 / 60.0);
+    for (std::size_t count : report.counts(1)) {
+        if (count > 1000000) {
+            break;
+        }
+        for (unsigned threads : threadCounts) {
+            JobSystem jobs(threads);
+            BenchResult result = measure("dispersion", "monte_carlo", count, threads, [] {},
+                [&] { analysis.run(jobs, setup, count); }, 1);
+            result.note = "cep=" + std::to_string(analysis.result().cep);
+            report.add(result);
+        }
+    }
+}
+
+// --fixture SNAPSHOT: every update kernel run in place on a saved world
+void benchFixture(BenchReport& report) {
+    const std::string& path = report.options().fixturePath;
+    if (path.empty() || !report.wants("fixture")) {
+        return;
+    }
+    MappedSnapshot fixture;
+    if (!fixture.open(path)) {
+        return;
+    }
+    for (int level = 0; level <= static_cast<int>(detectSimdLevel()); ++level) {
+        SimdLevel simd = static_cast<SimdLevel>(level);
+        ProjectileUpdateKernel kernel = selectUpdateKernel(simd);
+        BenchResult result = measure("fixture", simdLevelName(simd), fixture.size(), 1,
+            [&] { fixture.open(path); },
+            [&] { kernel(fixture.span(), STEP_TIME); }, STEPS_PER_REFILL);
+        result.note = "snapshot=" + path;
+        report.add(result);
+    }
+}
+
+// TRACE_SCOPE cost with recording on and off. Each item is one scope, i.e. a
+// begin and an end event; the rings are drained (untimed) before every rep.
+void benchTrace(BenchReport& report) {
+    if (!report.wants("trace")) {
+        return;
+    }
+    const std::size_t scopes = Tracer::BUFFER_EVENTS / 4;
+    std::ostream discard(nullptr);
+    for (bool enabled : {false, true}) {
+        report.add(measure("trace", enabled ? "scope_enabled" : "scope_disabled", scopes, 1,
+            [&] {
+                Tracer::instance().setEnabled(enabled);
+                Tracer::instance().flush(discard);
+            },
+            [&] {
+                for (std::size_t i = 0; i < scopes; ++i) {
+                    TRACE_SCOPE("bench");
+                }
+            }, 1));
+    }
+    Tracer::instance().setEnabled(false);
+}
+
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (value && arg == "--max-count") {
+            options.maxCount = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--filter") {
+            options.filter = value;
+        } else if (value && arg == "--out") {
+            options.outPath = value;
+        } else if (value && arg == "--fixture") {
+            options.fixturePath = value;
+        } else {
+            std::cerr << "Unknown or incomplete option " << arg << "\n"
+                      << "Usage: cannon_bench [--max-count N] [--filter SUBSTRING] [--out FILE]"
+                      << " [--fixture SNAPSHOT]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        return -1;
+    }
+
+    BenchReport report(options);
+    benchUpdate(report);
+    benchParallelUpdate(report);
+    benchCompaction(report);
+    benchSpawn(report);
+    benchDrawSubmission(report);
+    benchCollisions(report);
+    benchNarrowphase(report);
+    benchBallistic(report);
+    benchTimers(report);
+    benchFixed(report);
+    benchSnapshot(report);
+    benchRewind(report);
+    benchExport(report);
+    benchFiring(report);
+    benchFiringTable(report);
+    benchDispersion(report);
+    benchFixture(report);
+    benchTrace(report);
+
+    std::string simd = simdLevelName(detectSimdLevel());
+    if (options.outPath.empty()) {
+        report.writeJson(std::cout, simd);
+    } else {
+        std::ofstream out(options.outPath);
+        if (!out) {
+            std::cerr << "Failed to open " << options.outPath << std::endl;
+            return -1;
+        }
+        report.writeJson(out, simd);
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ballistic_engine.h"
+#include "job_system.h"
+#include "projectile_store.h"
+#include <cstddef>
+#include <cstdint>
+
+// RGBA8 colors in little-endian byte order, as the instance attribute reads them
+const std::uint32_t PROJECTILE_COLOR = 0xFF1A1AE6u;    // glColor3f(0.9f, 0.1f, 0.1f)
+const std::uint32_t CANNON_BASE_COLOR = 0xFF808080u;   // glColor3f(0.5f, 0.5f, 0.5f)
+const std::uint32_t IMPACT_MARKER_COLOR = 0xFF33E6E6u; // glColor3f(0.9f, 0.9f, 0.2f)
+
+// Per-instance data the circle shaders read; 16 bytes per circle
+struct CircleInstance {
+    float x;
+    float y;
+    float radius;
+    std::uint32_t color;
+};
+
+// Instances written per parallel fill chunk
+const std::size_t CIRCLE_FILL_GRAIN = 16384;
+
+// The CPU side of instanced projectile drawing, kept free of GL so it can be
+// benchmarked headless: one instance per projectile at its interpolated
+// position. Inactive projectiles get a zero radius rather than a branch.
+inline void fillProjectileInstances(const ProjectileStore& projectiles, float alpha,
+                                    CircleInstance* instances, JobSystem& jobs) {
+    const float* posX = projectiles.posX();
+    const float* posY = projectiles.posY();
+    const float* prevX = projectiles.prevX();
+    const float* prevY = projectiles.prevY();
+    const float* radius = projectiles.radius();
+    const std::uint8_t* active = projectiles.active();
+    jobs.parallelFor(0, projectiles.size(), CIRCLE_FILL_GRAIN, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            CircleInstance& instance = instances[i];
+            instance.x = prevX[i] + (posX[i] - prevX[i]) * alpha;
+            instance.y = prevY[i] + (posY[i] - prevY[i]) * alpha;
+            instance.radius = active[i] ? radius[i] : 0.0f;
+            instance.color = PROJECTILE_COLOR;
+        }
+    });
+}
+
+// Instances for the flights of the event-driven engine: each position is
+// evaluated from its arc at the engine's current time, so nothing to interpolate
+inline void fillFlightInstances(const BallisticEngine& flights, CircleInstance* instances, JobSystem& jobs) {
+    jobs.parallelFor(0, flights.size(), CIRCLE_FILL_GRAIN, [&](std::size_t begin, std::size_t end) {
+        CircleInstance* instance = instances + begin;
+        flights.forEach(begin, end, [&](glm::vec2 position, float radius) {
+            *instance++ = CircleInstance{position.x, position.y, radius, PROJECTILE_COLOR};
+        });
+    });
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "circle_instances.h"
+#include "gl_util.h"
+#include "job_system.h"
+#include "projectile.h"
+#include "projectile_store.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// How InstancedCircleRenderer turns one circle instance into pixels
+enum class CircleStyle {
+    Fan, // 36-segment unit-circle triangle fan, same as the immediate-mode path
+    Sdf  // one screen-aligned quad, coverage from a signed distance per fragment
+};
+
+// Draws circles with instanced calls against a shared mesh. drawProjectiles
+// streams one instance per projectile into a buffer refilled once per frame;
+// drawCircle draws a single circle from constant attributes.
+class InstancedCircleRenderer {
+public:
+    InstancedCircleRenderer()
+        : instanceBuffer_(0), instanceCapacity_(0) {}
+
+    ~InstancedCircleRenderer() { destroy(); }
+
+    InstancedCircleRenderer(const InstancedCircleRenderer&) = delete;
+    InstancedCircleRenderer& operator=(const InstancedCircleRenderer&) = delete;
+
+    bool ready() const { return fan_.program != 0 && sdf_.program != 0; }
+
+    // Needs a current GL 3.3 context; returns false if the shaders do not build
+    bool init() {
+        // Unit circle as a triangle fan: centre plus 37 rim vertices
+        float fanMesh[2 * (CIRCLE_SEGMENTS + 2)];
+        fanMesh[0] = 0.0f;
+        fanMesh[1] = 0.0f;
+        for (int i = 0; i <= CIRCLE_SEGMENTS; ++i) {
+            float radian = i * 2.0f * PI / CIRCLE_SEGMENTS;
+            fanMesh[2 + 2 * i] = std::cos(radian);
+            fanMesh[3 + 2 * i] = std::sin(radian);
+        }
+        // Quad covering the unit circle, as a triangle strip
+        const float quadMesh[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+
+        glGenBuffers(1, &instanceBuffer_);
+        bool ok = fan_.init(FAN_VERTEX_SHADER, FAN_FRAGMENT_SHADER, fanMesh, sizeof(fanMesh),
+                            GL_TRIANGLE_FAN, CIRCLE_SEGMENTS + 2, instanceBuffer_) &&
+                  sdf_.init(SDF_VERTEX_SHADER, SDF_FRAGMENT_SHADER, quadMesh, sizeof(quadMesh),
+                            GL_TRIANGLE_STRIP, 4, instanceBuffer_);
+        if (!ok) {
+            destroy();
+        }
+        return ok;
+    }
+
+    void destroy() {
+        fan_.destroy();
+        sdf_.destroy();
+        if (instanceBuffer_) glDeleteBuffers(1, &instanceBuffer_);
+        instanceBuffer_ = 0;
+        instanceCapacity_ = 0;
+    }
+
+    // Uploads one instance per projectile (see fillProjectileInstances) and draws them all
+    void drawProjectiles(const ProjectileStore& projectiles, float alpha, glm::vec2 viewportSize,
+                         CircleStyle style, JobSystem& jobs) {
+        drawInstances(projectiles.size(), viewportSize, style, [&](CircleInstance* instances) {
+            fillProjectileInstances(projectiles, alpha, instances, jobs);
+        });
+    }
+
+    // Same for the flights of the event-driven engine, at its current time
+    void drawFlights(const BallisticEngine& flights, glm::vec2 viewportSize, CircleStyle style, JobSystem& jobs) {
+        drawInstances(flights.size(), viewportSize, style, [&](CircleInstance* instances) {
+            fillFlightInstances(flights, instances, jobs);
+        });
+    }
+
+    // One circle, no buffer upload: the instance attributes are set as constants
+    void drawCircle(glm::vec2 center, float radius, std::uint32_t color, glm::vec2 viewportSize,
+                    CircleStyle style) {
+        if (!ready()) {
+            return;
+        }
+        Pipeline& pipeline = style == CircleStyle::Sdf ? sdf_ : fan_;
+        pipeline.begin(viewportSize, pipeline.singleVao);
+        glVertexAttrib3f(1, center.x, center.y, radius);
+        glVertexAttrib4Nub(2, color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, color >> 24);
+        glDrawArrays(pipeline.primitive, 0, pipeline.vertexCount);
+        pipeline.end();
+    }
+
+private:
+    static const int CIRCLE_SEGMENTS = 36;
+
+    // Maps `count` instances, lets fill(instances) write them, and draws them
+    template <typename Fill>
+    void drawInstances(std::size_t count, glm::vec2 viewportSize, CircleStyle style, Fill fill) {
+        if (!ready() || count == 0) {
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+        if (count > instanceCapacity_) {
+            instanceCapacity_ = count + count / 2;
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity_ * sizeof(CircleInstance), NULL, GL_STREAM_DRAW);
+        }
+        CircleInstance* instances = static_cast<CircleInstance*>(glMapBufferRange(
+            GL_ARRAY_BUFFER, 0, count * sizeof(CircleInstance), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (!instances) {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return;
+        }
+        fill(instances);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        Pipeline& pipeline = style == CircleStyle::Sdf ? sdf_ : fan_;
+        pipeline.begin(viewportSize, pipeline.instancedVao);
+        glDrawArraysInstanced(pipeline.primitive, 0, pipeline.vertexCount, static_cast<GLsizei>(count));
+        pipeline.end();
+    }
+
+    // Program plus mesh for one CircleStyle. instancedVao reads the instance
+    // buffer; singleVao leaves attributes 1 and 2 to constant values.
+    struct Pipeline {
+        GLuint program = 0;
+        GLuint meshBuffer = 0;
+        GLuint instancedVao = 0;
+        GLuint singleVao = 0;
+        GLint viewportLocation = -1;
+        GLenum primitive = GL_TRIANGLES;
+        GLsizei vertexCount = 0;
+
+        bool init(const char* vertexSource, const char* fragmentSource, const float* mesh,
+                  std::size_t meshBytes, GLenum meshPrimitive, GLsizei meshVertices, GLuint instanceBuffer) {
+            program = createShaderProgram(vertexSource, fragmentSource);
+            if (!program) {
+                return false;
+            }
+            viewportLocation = glGetUniformLocation(program, "uViewport");
+            primitive = meshPrimitive;
+            vertexCount = meshVertices;
+
+            glGenBuffers(1, &meshBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+            glBufferData(GL_ARRAY_BUFFER, meshBytes, mesh, GL_STATIC_DRAW);
+
+            glGenVertexArrays(1, &instancedVao);
+            glBindVertexArray(instancedVao);
+            glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (void*)offsetof(CircleInstance, x));
+            glVertexAttribDivisor(1, 1);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CircleInstance), (void*)offsetof(CircleInstance, color));
+            glVertexAttribDivisor(2, 1);
+
+            glGenVertexArrays(1, &singleVao);
+            glBindVertexArray(singleVao);
+            glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return true;
+        }
+
+        void destroy() {
+            if (singleVao) glDeleteVertexArrays(1, &singleVao);
+            if (instancedVao) glDeleteVertexArrays(1, &instancedVao);
+            if (meshBuffer) glDeleteBuffers(1, &meshBuffer);
+            if (program) glDeleteProgram(program);
+            program = meshBuffer = instancedVao = singleVao = 0;
+        }
+
+        void begin(glm::vec2 viewportSize, GLuint vao) {
+            glUseProgram(program);
+            glUniform2f(viewportLocation, viewportSize.x, viewportSize.y);
+            glBindVertexArray(vao);
+        }
+
+        void end() {
+            glBindVertexArray(0);
+            glUseProgram(0);
+        }
+    };
+
+    static constexpr const char* FAN_VERTEX_SHADER = R"(#version 330 core
+        layout(location = 0) in vec2 aCircle;
+        layout(location = 1) in vec3 aInstance; // x, y, radius
+        layout(location = 2) in vec4 aColor;
+        uniform vec2 uViewport;
+        out vec4 vColor;
+        void main() {
+            vec2 world = aInstance.xy + aCircle * aInstance.z;
+            gl_Position = vec4(world / uViewport * 2.0 - 1.0, 0.0, 1.0);
+            vColor = aColor;
+        }
+    )";
+
+    static constexpr const char* FAN_FRAGMENT_SHADER = R"(#version 330 core
+        in vec4 vColor;
+        out vec4 fragColor;
+        void main() {
+            fragColor = vColor;
+        }
+    )";
+
+    // The quad is grown by one world unit (one pixel at the default projection)
+    // so the anti-aliased rim is not clipped
+    static constexpr const char* SDF_VERTEX_SHADER = R"(#version 330 core
+        layout(location = 0) in vec2 aCorner;
+        layout(location = 1) in vec3 aInstance; // x, y, radius
+        layout(location = 2) in vec4 aColor;
+        uniform vec2 uViewport;
+        out vec2 vLocal;
+        out float vRadius;
+        out vec4 vColor;
+        void main() {
+            float extent = aInstance.z > 0.0 ? aInstance.z + 1.0 : 0.0;
+            vLocal = aCorner * extent;
+            vRadius = aInstance.z;
+            vec2 world = aInstance.xy + vLocal;
+            gl_Position = vec4(world / uViewport * 2.0 - 1.0, 0.0, 1.0);
+            vColor = aColor;
+        }
+    )";
+
+    // Coverage falls from 1 to 0 across one pixel centred on the edge, measured
+    // with fwidth so the ramp stays one pixel wide at any scale
+    static constexpr const char* SDF_FRAGMENT_SHADER = R"(#version 330 core
+        in vec2 vLocal;
+        in float vRadius;
+        in vec4 vColor;
+        out vec4 fragColor;
+        void main() {
+            float distance = length(vLocal) - vRadius;
+            float aa = max(fwidth(distance), 1e-4);
+            float coverage = clamp(0.5 - distance / aa, 0.0, 1.0);
+            if (coverage <= 0.0) {
+                discard;
+            }
+            fragColor = vec4(vColor.rgb, vColor.a * coverage);
+        }
+    )";
+
+    Pipeline fan_;
+    Pipeline sdf_;
+    GLuint instanceBuffer_;
+    std::size_t instanceCapacity_;
+};
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "job_system.h"
+#include "projectile_store.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Two projectiles whose bounding boxes overlap, by dense store index (a < b in grid order)
+struct CollisionPair {
+    std::uint32_t a;
+    std::uint32_t b;
+};
+
+// Overlapping pair with the unit normal from a towards b and the overlap depth
+struct Contact {
+    std::uint32_t a;
+    std::uint32_t b;
+    float normalX;
+    float normalY;
+    float depth;
+};
+
+// Uniform-grid broadphase over active projectiles, rebuilt from scratch each step.
+// Cells are one largest diameter wide, so two overlapping circles always sit in
+// the same or neighbouring cells. Cell coordinates wrap around a power-of-two
+// table of about two buckets per projectile, which hashes any extent into a
+// fixed table while keeping row-major order: the 3x3 neighbourhood of a cell
+// is three runs of three adjacent buckets. Projectiles are counting-sorted by
+// bucket into contiguous position/radius columns that the queries stream through.
+class CollisionGrid {
+public:
+    // Projectiles per parallel pair-finding chunk
+    static const std::size_t PAIR_GRAIN = 8192;
+
+    CollisionGrid()
+        : cellSize_(1.0f), inverseCellSize_(1.0f), columnMask_(0), rowMask_(0), columnShift_(0), entries_(0) {}
+
+    CollisionGrid(const CollisionGrid&) = delete;
+    CollisionGrid& operator=(const CollisionGrid&) = delete;
+
+    std::size_t entries() const { return entries_; }
+    std::size_t buckets() const { return std::size_t(columnMask_ + 1) * (rowMask_ + 1); }
+    float cellSize() const { return cellSize_; }
+
+    // Bucket rows taken two at a time. A shell in one pair of rows only overlaps
+    // shells in that pair and the rows either side of it, so contacts found from
+    // pairs two apart never share a shell. There are at least four pairs, always
+    // an even number, so this holds across the wrap too.
+    std::size_t rowPairs() const { return (std::size_t(rowMask_) + 1) / 2; }
+    std::size_t rowPairOf(std::uint32_t index) const { return bucketOf_[index] >> (columnShift_ + 1); }
+
+    void build(const ProjectileSpan& span) {
+        float maxRadius = 0.0f;
+        std::size_t live = 0;
+        for (std::size_t i = 0; i < span.count; ++i) {
+            if (span.active[i]) {
+                maxRadius = std::max(maxRadius, span.radius[i]);
+                ++live;
+            }
+        }
+        entries_ = live;
+        cellSize_ = std::max(2.0f * maxRadius, 1e-3f);
+        inverseCellSize_ = 1.0f / cellSize_;
+
+        // At least 8 x 8 so the three rows and columns of a neighbourhood never alias
+        columnShift_ = 3;
+        int rowShift = 3;
+        while ((std::size_t(1) << (columnShift_ + rowShift)) < 2 * live) {
+            if (rowShift < columnShift_) {
+                ++rowShift;
+            } else {
+                ++columnShift_;
+            }
+        }
+        columnMask_ = (1u << columnShift_) - 1;
+        rowMask_ = (1u << rowShift) - 1;
+        std::size_t bucketCount = buckets();
+
+        bucketOf_.resize(span.count);
+        bucketStart_.resize(bucketCount + 1);
+        std::memset(bucketStart_.data(), 0, (bucketCount + 1) * sizeof(std::uint32_t));
+        for (std::size_t i = 0; i < span.count; ++i) {
+            if (span.active[i]) {
+                std::uint32_t bucket = bucketAt(cellCoord(span.posX[i]), cellCoord(span.posY[i]));
+                bucketOf_[i] = bucket;
+                ++bucketStart_[bucket + 1];
+            }
+        }
+        for (std::size_t b = 0; b < bucketCount; ++b) {
+            bucketStart_[b + 1] += bucketStart_[b];
+        }
+
+        // Stable scatter, so bucket contents are in store order and the result is deterministic
+        sortedIndex_.resize(live);
+        sortedX_.resize(live);
+        sortedY_.resize(live);
+        sortedRadius_.resize(live);
+        fill_.resize(bucketCount);
+        std::memcpy(fill_.data(), bucketStart_.data(), bucketCount * sizeof(std::uint32_t));
+        for (std::size_t i = 0; i < span.count; ++i) {
+            if (span.active[i]) {
+                std::uint32_t slot = fill_[bucketOf_[i]]++;
+                sortedIndex_[slot] = static_cast<std::uint32_t>(i);
+                sortedX_[slot] = span.posX[i];
+                sortedY_[slot] = span.posY[i];
+                sortedRadius_[slot] = span.radius[i];
+            }
+        }
+    }
+
+    // Every pair of active projectiles whose bounding boxes overlap, each once.
+    // Counted then written in two parallel passes, so the order does not depend
+    // on thread count. Both passes add the box test result instead of branching
+    // on it; the writer always stores a pair and advances only on a hit.
+    void findPairs(JobSystem& jobs, AlignedArray<CollisionPair>& pairs) {
+        pairOffset_.resize(entries_ + 1);
+        std::uint32_t* offsets = pairOffset_.data();
+        jobs.parallelFor(0, entries_, PAIR_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                std::uint32_t found = 0;
+                forEachCandidate(k, [&found](std::size_t, unsigned hit) { found += hit; });
+                offsets[k + 1] = found;
+            }
+        });
+        offsets[0] = 0;
+        for (std::size_t k = 0; k < entries_; ++k) {
+            offsets[k + 1] += offsets[k];
+        }
+
+        pairs.resize(offsets[entries_]);
+        CollisionPair* out = pairs.data();
+        const std::uint32_t* sortedIndex = sortedIndex_.data();
+        jobs.parallelFor(0, entries_, PAIR_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                CollisionPair* next = out + offsets[k];
+                std::uint32_t a = sortedIndex[k];
+                if (offsets[k + 1] < offsets[end]) {
+                    // A miss after the last hit stores into the slot after k's
+                    // range, which a later entry of this same chunk overwrites
+                    forEachCandidate(k, [&](std::size_t l, unsigned hit) {
+                        *next = CollisionPair{a, sortedIndex[l]};
+                        next += hit;
+                    });
+                } else {
+                    // The slot after k's range belongs to another chunk (or is
+                    // past the end): store hits only
+                    forEachCandidate(k, [&](std::size_t l, unsigned hit) {
+                        if (hit) {
+                            *next++ = CollisionPair{a, sortedIndex[l]};
+                        }
+                    });
+                }
+            }
+        });
+    }
+
+private:
+    int cellCoord(float v) const { return static_cast<int>(std::floor(v * inverseCellSize_)); }
+
+    std::uint32_t bucketAt(int cx, int cy) const {
+        return ((static_cast<std::uint32_t>(cy) & rowMask_) << columnShift_) | (static_cast<std::uint32_t>(cx) & columnMask_);
+    }
+
+    // Calls visit(l, hit) for every sorted entry l > k in the 3x3 cells around
+    // entry k, with hit = 1 if l's bounding box overlaps k's and 0 otherwise.
+    // Cells are scanned as one run of three buckets per row, or one bucket at a
+    // time where the row wraps around the table edge. Cells far apart can wrap
+    // onto the same bucket; the box test drops those entries.
+    template <typename Visit>
+    void forEachCandidate(std::size_t k, Visit visit) const {
+        // Local pointers: the member arrays would otherwise be reloaded after every visit
+        const float* xs = sortedX_.data();
+        const float* ys = sortedY_.data();
+        const float* radii = sortedRadius_.data();
+        const std::uint32_t* starts = bucketStart_.data();
+        float x = xs[k];
+        float y = ys[k];
+        float r = radii[k];
+        int cx = cellCoord(x);
+        int cy = cellCoord(y);
+
+        auto scan = [&](std::uint32_t firstBucket, std::uint32_t lastBucket) {
+            std::size_t last = starts[lastBucket + 1];
+            for (std::size_t l = std::max<std::size_t>(starts[firstBucket], k + 1); l < last; ++l) {
+                float reach = r + radii[l];
+                visit(l, static_cast<unsigned>(std::fabs(xs[l] - x) < reach) &
+                         static_cast<unsigned>(std::fabs(ys[l] - y) < reach));
+            }
+        };
+        std::uint32_t left = static_cast<std::uint32_t>(cx - 1) & columnMask_;
+        for (int dy = -1; dy <= 1; ++dy) {
+            std::uint32_t row = bucketAt(0, cy + dy);
+            if (left + 2 <= columnMask_) {
+                scan(row + left, row + left + 2);
+            } else {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    std::uint32_t bucket = bucketAt(cx + dx, cy + dy);
+                    scan(bucket, bucket);
+                }
+            }
+        }
+    }
+
+    float cellSize_;
+    float inverseCellSize_;
+    std::uint32_t columnMask_;
+    std::uint32_t rowMask_;
+    int columnShift_;
+    std::size_t entries_;
+    AlignedArray<std::uint32_t> bucketOf_;     // per store index, active projectiles only
+    AlignedArray<std::uint32_t> bucketStart_;  // bucketCount + 1 prefix sums into the sorted columns
+    AlignedArray<std::uint32_t> fill_;
+    AlignedArray<std::uint32_t> sortedIndex_;
+    AlignedArray<float> sortedX_;
+    AlignedArray<float> sortedY_;
+    AlignedArray<float> sortedRadius_;
+    AlignedArray<std::uint32_t> pairOffset_;
+};
+
+// Narrowphase for pairs [0, pairCount): writes the candidate pairs whose
+// circles actually overlap to `out`, in pair order, and returns how many
+inline std::size_t writeContacts(const ProjectileSpan& span, const CollisionPair* pairs, std::size_t pairCount,
+                                 Contact* out) {
+    std::size_t written = 0;
+    for (std::size_t p = 0; p < pairCount; ++p) {
+        std::uint32_t a = pairs[p].a;
+        std::uint32_t b = pairs[p].b;
+        float dx = span.posX[b] - span.posX[a];
+        float dy = span.posY[b] - span.posY[a];
+        float reach = span.radius[a] + span.radius[b];
+        float distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared >= reach * reach) {
+            continue;
+        }
+        float distance = std::sqrt(distanceSquared);
+        Contact contact{a, b, 1.0f, 0.0f, reach - distance};
+        if (distance > 0.0f) {
+            contact.normalX = dx / distance;
+            contact.normalY = dy / distance;
+        }
+        out[written++] = contact;
+    }
+    return written;
+}
+
+// Narrowphase: keeps the candidate pairs whose circles actually overlap
+inline void findContacts(const ProjectileSpan& span, const CollisionPair* pairs, std::size_t pairCount,
+                         AlignedArray<Contact>& contacts) {
+    contacts.resize(pairCount);
+    contacts.resize(writeContacts(span, pairs, pairCount, contacts.data()));
+}
+
+// findContacts or one of its SIMD versions (collision_simd.h)
+typedef void (*NarrowphaseKernel)(const ProjectileSpan& span, const CollisionPair* pairs, std::size_t pairCount,
+                                  AlignedArray<Contact>& contacts);
+
+// Elastic response with mass proportional to area: pushes each pair apart by its
+// depth and exchanges momentum along the normal if the pair is approaching.
+// Contacts are applied in order, each seeing the velocities left by the previous.
+// ProjectileCollisions::step runs this over independent runs of contacts at once.
+inline void resolveContacts(const ProjectileSpan& span, const Contact* contacts, std::size_t contactCount) {
+    for (std::size_t c = 0; c < contactCount; ++c) {
+        const Contact& contact = contacts[c];
+        std::uint32_t a = contact.a;
+        std::uint32_t b = contact.b;
+        float inverseMassA = 1.0f / (span.radius[a] * span.radius[a]);
+        float inverseMassB = 1.0f / (span.radius[b] * span.radius[b]);
+        float inverseMassSum = inverseMassA + inverseMassB;
+
+        // Separate, each moving in proportion to its inverse mass
+        float push = contact.depth / inverseMassSum;
+        span.posX[a] -= contact.normalX * push * inverseMassA;
+        span.posY[a] -= contact.normalY * push * inverseMassA;
+        span.posX[b] += contact.normalX * push * inverseMassB;
+        span.posY[b] += contact.normalY * push * inverseMassB;
+
+        // Closing speed along the normal; pairs already separating keep their velocities
+        float closing = (span.velX[a] - span.velX[b]) * contact.normalX +
+                        (span.velY[a] - span.velY[b]) * contact.normalY;
+        if (closing <= 0.0f) {
+            continue;
+        }
+        float impulse = 2.0f * closing / inverseMassSum;
+        span.velX[a] -= contact.normalX * impulse * inverseMassA;
+        span.velY[a] -= contact.normalY * impulse * inverseMassA;
+        span.velX[b] += contact.normalX * impulse * inverseMassB;
+        span.velY[b] += contact.normalY * impulse * inverseMassB;
+    }
+}
+
+// Broadphase, narrowphase and response for one simulation step, with the
+// scratch buffers kept between steps so a steady state allocates nothing
+class ProjectileCollisions {
+public:
+    // Row pairs (CollisionGrid::rowPairs) per parallel response chunk
+    static const std::size_t RESOLVE_GRAIN = 4;
+
+    ProjectileCollisions() : narrowphase_(findContacts) {}
+
+    ProjectileCollisions(const ProjectileCollisions&) = delete;
+    ProjectileCollisions& operator=(const ProjectileCollisions&) = delete;
+
+    void setNarrowphase(NarrowphaseKernel narrowphase) { narrowphase_ = narrowphase; }
+
+    // Returns the number of contacts resolved
+    std::size_t step(const ProjectileSpan& span, JobSystem& jobs) {
+        grid_.build(span);
+        grid_.findPairs(jobs, pairs_);
+        narrowphase_(span, pairs_.data(), pairs_.size(), contacts_);
+        resolve(span, jobs);
+        return contacts_.size();
+    }
+
+    std::size_t pairCount() const { return pairs_.size(); }
+    std::size_t contactCount() const { return contacts_.size(); }
+
+private:
+    // Contacts are in grid order, so each pair of bucket rows owns one run of
+    // them. The even pairs' runs are resolved in parallel, then the odd pairs':
+    // runs resolved together touch disjoint shells, and each run is applied in
+    // order, so the result does not depend on thread count.
+    void resolve(const ProjectileSpan& span, JobSystem& jobs) {
+        const Contact* contacts = contacts_.data();
+        std::size_t contactCount = contacts_.size();
+        const CollisionGrid& grid = grid_;
+        auto runStart = [&](std::size_t rowPair) {
+            return std::partition_point(contacts, contacts + contactCount, [&](const Contact& contact) {
+                return grid.rowPairOf(contact.a) < rowPair;
+            });
+        };
+        std::size_t half = grid.rowPairs() / 2;
+        for (std::size_t parity = 0; parity < 2; ++parity) {
+            jobs.parallelFor(0, half, RESOLVE_GRAIN, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t k = begin; k < end; ++k) {
+                    std::size_t rowPair = 2 * k + parity;
+                    const Contact* first = runStart(rowPair);
+                    resolveContacts(span, first, static_cast<std::size_t>(runStart(rowPair + 1) - first));
+                }
+            });
+        }
+    }
+
+    NarrowphaseKernel narrowphase_;
+    CollisionGrid grid_;
+    AlignedArray<CollisionPair> pairs_;
+    AlignedArray<Contact> contacts_;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "collision_grid.h"
+#include "projectile_simd.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Explicit SIMD versions of findContacts (the circle-circle narrowphase), 8 or
+// 16 candidate pairs per instruction. Each batch gathers both projectiles'
+// position and radius into SoA registers, tests overlap for every lane, and
+// appends the overlapping lanes to the contact list in pair order; the last
+// pairCount % width pairs go through the scalar writeContacts. The
+// arithmetic matches findContacts operation for operation (no FMA contraction,
+// correctly rounded sqrt and division), so the contact lists are identical.
+
+#ifdef CANNON_SIMD_X86
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// Stores every lane and advances past the ones set in `hits`, in lane order.
+// Branching on each lane mispredicts at typical hit rates; the stores after the
+// last hit land in slots the next batch (or the final resize) discards, and
+// never pass the pair's own slot.
+inline std::size_t appendContactLanes(Contact* out, unsigned hits, int width, const std::uint32_t* a,
+                                      const std::uint32_t* b, const float* normalX, const float* normalY,
+                                      const float* depth) {
+    std::size_t written = 0;
+    for (int lane = 0; lane < width; ++lane) {
+        out[written] = Contact{a[lane], b[lane], normalX[lane], normalY[lane], depth[lane]};
+        written += (hits >> lane) & 1u;
+    }
+    return written;
+}
+
+__attribute__((target("avx2")))
+inline void findContactsAVX2(const ProjectileSpan& span, const CollisionPair* pairs, std::size_t pairCount,
+                             AlignedArray<Contact>& contacts) {
+    contacts.resize(pairCount);
+    Contact* out = contacts.data();
+    std::size_t written = 0;
+
+    const __m256i evenOdd = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    alignas(32) std::uint32_t a[8], b[8];
+    alignas(32) float normalX[8], normalY[8], depth[8];
+
+    std::size_t p = 0;
+    for (; p + 8 <= pairCount; p += 8) {
+        // Eight {a, b} pairs -> one register of a indices and one of b indices
+        __m256i low = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs + p)), evenOdd);
+        __m256i high = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs + p + 4)), evenOdd);
+        __m256i ia = _mm256_permute2x128_si256(low, high, 0x20);
+        __m256i ib = _mm256_permute2x128_si256(low, high, 0x31);
+
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(span.posX, ib, 4), _mm256_i32gather_ps(span.posX, ia, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(span.posY, ib, 4), _mm256_i32gather_ps(span.posY, ia, 4));
+        __m256 reach = _mm256_add_ps(_mm256_i32gather_ps(span.radius, ia, 4), _mm256_i32gather_ps(span.radius, ib, 4));
+        __m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        unsigned hits = static_cast<unsigned>(_mm256_movemask_ps(
+            _mm256_cmp_ps(distanceSquared, _mm256_mul_ps(reach, reach), _CMP_LT_OQ)));
+        if (!hits) {
+            continue;
+        }
+
+        // Coincident centres get the (1, 0) normal, as in findContacts
+        __m256 distance = _mm256_sqrt_ps(distanceSquared);
+        __m256 apart = _mm256_cmp_ps(distance, zero, _CMP_GT_OQ);
+        _mm256_store_ps(normalX, _mm256_blendv_ps(one, _mm256_div_ps(dx, distance), apart));
+        _mm256_store_ps(normalY, _mm256_blendv_ps(zero, _mm256_div_ps(dy, distance), apart));
+        _mm256_store_ps(depth, _mm256_sub_ps(reach, distance));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(a), ia);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b), ib);
+        written += appendContactLanes(out + written, hits, 8, a, b, normalX, normalY, depth);
+    }
+    written += writeContacts(span, pairs + p, pairCount - p, out + written);
+    contacts.resize(written);
+}
+
+// Masked forms: the plain gather and sqrt trip GCC 12's -Wmaybe-uninitialized
+// on their undefined merge source
+__attribute__((target("avx512f")))
+inline __m512 gather16(const float* base, __m512i index) {
+    return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, index, base, 4);
+}
+
+__attribute__((target("avx512f")))
+inline void findContactsAVX512(const ProjectileSpan& span, const CollisionPair* pairs, std::size_t pairCount,
+                               AlignedArray<Contact>& contacts) {
+    contacts.resize(pairCount);
+    Contact* out = contacts.data();
+    std::size_t written = 0;
+
+    const __m512i evens = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odds = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    alignas(64) std::uint32_t a[16], b[16];
+    alignas(64) float normalX[16], normalY[16], depth[16];
+
+    std::size_t p = 0;
+    for (; p + 16 <= pairCount; p += 16) {
+        // Sixteen {a, b} pairs -> one register of a indices and one of b indices
+        __m512i first = _mm512_loadu_si512(pairs + p);
+        __m512i second = _mm512_loadu_si512(pairs + p + 8);
+        __m512i ia = _mm512_permutex2var_epi32(first, evens, second);
+        __m512i ib = _mm512_permutex2var_epi32(first, odds, second);
+
+        __m512 dx = _mm512_sub_ps(gather16(span.posX, ib), gather16(span.posX, ia));
+        __m512 dy = _mm512_sub_ps(gather16(span.posY, ib), gather16(span.posY, ia));
+        __m512 reach = _mm512_add_ps(gather16(span.radius, ia), gather16(span.radius, ib));
+        __m512 distanceSquared = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+        __mmask16 hits = _mm512_cmp_ps_mask(distanceSquared, _mm512_mul_ps(reach, reach), _CMP_LT_OQ);
+        if (!hits) {
+            continue;
+        }
+
+        // Coincident centres get the (1, 0) normal, as in findContacts
+        __m512 distance = _mm512_maskz_sqrt_ps(0xFFFF, distanceSquared);
+        __mmask16 apart = _mm512_cmp_ps_mask(distance, zero, _CMP_GT_OQ);
+        _mm512_store_ps(normalX, _mm512_mask_div_ps(one, apart, dx, distance));
+        _mm512_store_ps(normalY, _mm512_mask_div_ps(zero, apart, dy, distance));
+        _mm512_store_ps(depth, _mm512_sub_ps(reach, distance));
+        _mm512_store_si512(a, ia);
+        _mm512_store_si512(b, ib);
+        written += appendContactLanes(out + written, hits, 16, a, b, normalX, normalY, depth);
+    }
+    written += writeContacts(span, pairs + p, pairCount - p, out + written);
+    contacts.resize(written);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+// There is no SSE2 narrowphase: without gathers, four lanes do not pay for the shuffles
+inline NarrowphaseKernel selectNarrowphaseKernel(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return findContactsAVX2;
+    case SimdLevel::AVX512: return findContactsAVX512;
+    default: return findContacts;
+    }
+}
+
+#else
+
+inline NarrowphaseKernel selectNarrowphaseKernel(SimdLevel) {
+    return findContacts;
+}
+
+#endif
+
+// Runs `kernel` and findContacts over the same random pairs (some with
+// coincident centres, count chosen to leave a tail for every vector width) and
+// returns the largest absolute difference in any contact field, or INFINITY if
+// the two disagree about which pairs touch.
+inline float compareNarrowphaseWithScalar(NarrowphaseKernel kernel, std::size_t count = 4099) {
+    ProjectileStore store;
+    std::mt19937 rng(54321);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (std::size_t i = 0; i < count; ++i) {
+        glm::vec2 position(unit(rng) * 200.0f, unit(rng) * 200.0f);
+        if (i % 97 == 1) {
+            position = store[i - 1].position();
+        }
+        store.push(Projectile(position, glm::vec2(0.0f), 2.0f + unit(rng) * 8.0f));
+    }
+    AlignedArray<CollisionPair> pairs;
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(count - 1));
+    for (std::size_t i = 0; i < 4 * count + 13; ++i) {
+        std::uint32_t a = pick(rng);
+        pairs.push_back(CollisionPair{a, i % 97 == 0 ? a ^ 1u : pick(rng)});
+    }
+
+    AlignedArray<Contact> expected;
+    AlignedArray<Contact> actual;
+    findContacts(store.span(), pairs.data(), pairs.size(), expected);
+    kernel(store.span(), pairs.data(), pairs.size(), actual);
+    if (expected.size() != actual.size()) {
+        return INFINITY;
+    }
+    float maxError = 0.0f;
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i].a != actual[i].a || expected[i].b != actual[i].b) {
+            return INFINITY;
+        }
+        maxError = std::fmax(maxError, std::fabs(expected[i].normalX - actual[i].normalX));
+        maxError = std::fmax(maxError, std::fabs(expected[i].normalY - actual[i].normalY));
+        maxError = std::fmax(maxError, std::fabs(expected[i].depth - actual[i].depth));
+    }
+    return maxError;
+}
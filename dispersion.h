@@ -0,0 +1,242 @@
+#pragma once
+
+#include "job_system.h"
+#include "projectile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Shots per parallel dispersion chunk
+const std::size_t DISPERSION_GRAIN = 1024;
+
+// Side of a density grid cell in pixels
+const float DISPERSION_CELL = 4.0f;
+
+// Launch noise and the hit test for a dispersion run. Each shot draws its own
+// angle, power and pivot offset from normal distributions around the aim.
+struct DispersionSetup {
+    float angle = 45.0f;         // aimed degrees above the horizon
+    float power = 50.0f;         // aimed muzzle speed
+    float angleSigma = 0.5f;     // degrees
+    float powerSigma = 1.0f;     // muzzle speed
+    float positionSigma = 1.0f;  // pixels, on each axis of the pivot
+    float hitRadius = 10.0f;     // a hit lands this close to the unperturbed shot
+    std::uint64_t seed = 1;
+};
+
+// Where one shot's centre first touched the ground or the right wall
+struct DispersionImpact {
+    float x;
+    float y;
+    float time; // seconds from launch
+    bool landed; // false if the shell was still in the air at the end of its lifetime
+};
+
+// Impact counts over the window, DISPERSION_CELL pixels a cell, row 0 at the
+// ground. Impacts off the left edge are counted in `outside`.
+struct DispersionGrid {
+    std::uint32_t columns = 0;
+    std::uint32_t rows = 0;
+    std::vector<std::uint32_t> counts;
+    std::size_t outside = 0;
+};
+
+struct DispersionResult {
+    std::size_t shots = 0;
+    std::size_t impacts = 0; // shots that touched the ground or wall in their lifetime
+    std::size_t hits = 0;    // impacts within hitRadius of the nominal impact
+    DispersionImpact nominal; // the unperturbed shot
+    glm::vec2 meanImpact;     // mean point of impact
+    glm::vec2 deviation;      // standard deviation of the impacts on each axis
+    float cep = 0.0f;         // radius around meanImpact holding half the impacts
+    float r90 = 0.0f;         // and 90% of them
+    DispersionGrid grid;
+
+    float hitProbability() const { return shots ? float(hits) / float(shots) : 0.0f; }
+};
+
+// Stateless random bits: the splitmix64 finalizer over a key and a counter, so
+// any value of the stream can be drawn without the ones before it
+inline std::uint64_t dispersionMix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline std::uint64_t dispersionRandom(std::uint64_t key, std::uint64_t counter) {
+    return dispersionMix(key + (counter + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+// Two standard normals from 64 random bits (Box-Muller); the first uniform is
+// in (0, 1] so its log is finite
+inline void dispersionNormals(std::uint64_t bits, float& first, float& second) {
+    float u1 = float((bits >> 40) + 1) * (1.0f / 16777216.0f);
+    float u2 = float((bits >> 8) & 0xFFFFFF) * (1.0f / 16777216.0f);
+    float radius = std::sqrt(-2.0f * std::log(u1));
+    first = radius * std::cos(2.0f * PI * u2);
+    second = radius * std::sin(2.0f * PI * u2);
+}
+
+// Flies one shot with Projectile::update, the game's own step, stopping at its
+// first impact with the ground or the wall instead of bouncing there (the
+// same hook flyFiringTableShot stops at the first ground impact with)
+inline DispersionImpact flyDispersionShot(glm::vec2 cannon, float angle, float power, float deltaTime) {
+    Projectile shell = launchProjectile(cannon, angle, power);
+    DispersionImpact impact{0.0f, 0.0f, 0.0f, false};
+    // Same tick count as the shell's lifetime timer at this rate
+    unsigned long long steps = stepsToExpire(deltaTime);
+    for (unsigned long long step = 0; step < steps; ++step) {
+        bool landed = shell.updateUntil(deltaTime, [&](float x, float y, bool, float elapsed) {
+            impact = DispersionImpact{x, y, step * deltaTime + elapsed, true};
+            return true;
+        });
+        if (landed) {
+            return impact;
+        }
+    }
+    return DispersionImpact{shell.position.x, shell.position.y, PROJECTILE_LIFETIME, false};
+}
+
+// Monte Carlo dispersion of a cannon's shots under launch noise.
+//
+// Shot i draws its noise from counter 2i and 2i + 1 of the seed's stream, so
+// it does not depend on which thread flies it. Impacts are written by index
+// and the statistics are summed in index order afterwards, so a seed gives the
+// same result, bit for bit, on any thread count.
+class DispersionAnalysis {
+public:
+    DispersionAnalysis(glm::vec2 cannonPosition, double stepSeconds)
+        : cannon_(cannonPosition), deltaTime_(static_cast<float>(stepSeconds)) {}
+
+    const DispersionResult& run(JobSystem& jobs, const DispersionSetup& setup, std::size_t shots) {
+        impacts_.resize(shots);
+        const std::uint64_t key = dispersionMix(setup.seed);
+        jobs.parallelFor(0, shots, DISPERSION_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                float angleNoise;
+                float powerNoise;
+                float xNoise;
+                float yNoise;
+                dispersionNormals(dispersionRandom(key, 2 * i), angleNoise, powerNoise);
+                dispersionNormals(dispersionRandom(key, 2 * i + 1), xNoise, yNoise);
+                glm::vec2 pivot(cannon_.x + setup.positionSigma * xNoise, cannon_.y + setup.positionSigma * yNoise);
+                impacts_[i] = flyDispersionShot(pivot, setup.angle + setup.angleSigma * angleNoise,
+                                                setup.power + setup.powerSigma * powerNoise, deltaTime_);
+            }
+        });
+        summarize(setup);
+        return result_;
+    }
+
+    const DispersionResult& result() const { return result_; }
+    const std::vector<DispersionImpact>& impacts() const { return impacts_; }
+
+    // The density grid as text: a header line, then "x,y,count" for every
+    // non-empty cell, x and y at the cell's centre
+    bool writeGrid(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Failed to open dispersion grid " << path << std::endl;
+            return false;
+        }
+        const DispersionGrid& grid = result_.grid;
+        file << "x,y,count\n";
+        for (std::uint32_t row = 0; row < grid.rows; ++row) {
+            for (std::uint32_t column = 0; column < grid.columns; ++column) {
+                std::uint32_t count = grid.counts[std::size_t(row) * grid.columns + column];
+                if (count) {
+                    file << (column + 0.5f) * DISPERSION_CELL << "," << (row + 0.5f) * DISPERSION_CELL << ","
+                         << count << "\n";
+                }
+            }
+        }
+        if (!file) {
+            std::cerr << "Failed to write dispersion grid " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void summarize(const DispersionSetup& setup) {
+        DispersionResult& result = result_;
+        result.shots = impacts_.size();
+        result.impacts = 0;
+        result.hits = 0;
+        result.nominal = flyDispersionShot(cannon_, setup.angle, setup.power, deltaTime_);
+
+        DispersionGrid& grid = result.grid;
+        grid.columns = static_cast<std::uint32_t>(std::ceil(WINDOW_WIDTH / DISPERSION_CELL));
+        grid.rows = static_cast<std::uint32_t>(std::ceil(WINDOW_HEIGHT / DISPERSION_CELL));
+        grid.counts.assign(std::size_t(grid.columns) * grid.rows, 0);
+        grid.outside = 0;
+
+        double sumX = 0.0;
+        double sumY = 0.0;
+        const float hitRadiusSquared = setup.hitRadius * setup.hitRadius;
+        for (const DispersionImpact& impact : impacts_) {
+            if (!impact.landed) {
+                continue;
+            }
+            ++result.impacts;
+            sumX += impact.x;
+            sumY += impact.y;
+            float dx = impact.x - result.nominal.x;
+            float dy = impact.y - result.nominal.y;
+            result.hits += result.nominal.landed && dx * dx + dy * dy <= hitRadiusSquared;
+
+            long column = static_cast<long>(std::floor(impact.x / DISPERSION_CELL));
+            long row = static_cast<long>(std::floor(impact.y / DISPERSION_CELL));
+            if (column < 0 || row < 0 || column >= long(grid.columns) || row >= long(grid.rows)) {
+                ++grid.outside;
+            } else {
+                ++grid.counts[std::size_t(row) * grid.columns + column];
+            }
+        }
+        if (result.impacts == 0) {
+            result.meanImpact = glm::vec2(NAN, NAN);
+            result.deviation = glm::vec2(NAN, NAN);
+            result.cep = NAN;
+            result.r90 = NAN;
+            return;
+        }
+
+        double meanX = sumX / result.impacts;
+        double meanY = sumY / result.impacts;
+        double varianceX = 0.0;
+        double varianceY = 0.0;
+        distances_.clear();
+        for (const DispersionImpact& impact : impacts_) {
+            if (impact.landed) {
+                double dx = impact.x - meanX;
+                double dy = impact.y - meanY;
+                varianceX += dx * dx;
+                varianceY += dy * dy;
+                distances_.push_back(static_cast<float>(std::sqrt(dx * dx + dy * dy)));
+            }
+        }
+        result.meanImpact = glm::vec2(meanX, meanY);
+        result.deviation = glm::vec2(std::sqrt(varianceX / result.impacts), std::sqrt(varianceY / result.impacts));
+        result.cep = quantile(0.5);
+        result.r90 = quantile(0.9);
+    }
+
+    // The q-quantile of distances_ (nearest rank), partially reordering it
+    float quantile(double q) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(q * distances_.size()));
+        std::vector<float>::iterator nth = distances_.begin() + (std::max<std::size_t>(rank, 1) - 1);
+        std::nth_element(distances_.begin(), nth, distances_.end());
+        return *nth;
+    }
+
+    glm::vec2 cannon_;
+    float deltaTime_;
+    std::vector<DispersionImpact> impacts_;
+    std::vector<float> distances_;
+    DispersionResult result_;
+};
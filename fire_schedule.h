@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One scripted salvo: at `frame`, aim the cannon and fire `count` shots
+struct FireEvent {
+    unsigned long long frame;
+    float angle;
+    float power;
+    int count;
+};
+
+// Scripted firing for runs without a keyboard (headless mode, benchmarks).
+// Events are kept sorted by frame and consumed in order.
+class FireSchedule {
+public:
+    FireSchedule() : next_(0) {}
+
+    // A salvo of `count` shots every `interval` frames, starting at frame 0
+    static FireSchedule periodic(unsigned long long frames, unsigned long long interval, int count,
+                                 float angle, float power) {
+        FireSchedule schedule;
+        interval = std::max(interval, 1ull);
+        for (unsigned long long frame = 0; frame < frames; frame += interval) {
+            schedule.events_.push_back(FireEvent{frame, angle, power, count});
+        }
+        return schedule;
+    }
+
+    // Text file, one event per line: "<frame> <angle> <power> [count]".
+    // Blank lines and lines starting with '#' are ignored.
+    bool load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Failed to open fire schedule " << path << std::endl;
+            return false;
+        }
+        events_.clear();
+        next_ = 0;
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            std::size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            FireEvent event{0, 0.0f, 0.0f, 1};
+            if (!(fields >> event.frame >> event.angle >> event.power)) {
+                std::cerr << path << ":" << lineNumber << ": expected <frame> <angle> <power> [count]" << std::endl;
+                return false;
+            }
+            fields >> event.count;
+            events_.push_back(event);
+        }
+        std::stable_sort(events_.begin(), events_.end(),
+            [](const FireEvent& a, const FireEvent& b) { return a.frame < b.frame; });
+        return true;
+    }
+
+    std::size_t size() const { return events_.size(); }
+
+    // Appends an event no earlier than the last one
+    void add(const FireEvent& event) { events_.push_back(event); }
+
+    // Makes `frame` the next frame to fire, forgetting what has been consumed
+    void seek(unsigned long long frame) {
+        next_ = std::lower_bound(events_.begin(), events_.end(), frame,
+            [](const FireEvent& event, unsigned long long f) { return event.frame < f; }) - events_.begin();
+    }
+
+    // Calls fire(event) for every event scheduled at or before `frame` not yet consumed
+    template <typename Fire>
+    void fireDue(unsigned long long frame, Fire fire) {
+        while (next_ < events_.size() && events_[next_].frame <= frame) {
+            fire(events_[next_]);
+            ++next_;
+        }
+    }
+
+private:
+    std::vector<FireEvent> events_;
+    std::size_t next_;
+};
@@ -0,0 +1,333 @@
+#pragma once
+
+#include "job_system.h"
+#include "projectile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Targets per parallel solver chunk, and per block of the chunk's Newton loops
+const std::size_t FIRING_GRAIN = 4096;
+const std::size_t FIRING_BLOCK = 256;
+
+// Newton steps for the least-power angle and for the power limit. Near a root
+// each roughly doubles the correct digits; the power limit bisects its bounds
+// when a step would leave them.
+const int FIRING_NEWTON_STEPS = 8;
+
+enum class FiringPath : std::uint8_t { Unreachable, Direct, OffWall };
+
+// Aim that puts a shell's centre through a target before its lifetime ends.
+// Off-wall solutions bounce off the right wall once on the way.
+struct FiringSolution {
+    float angle;      // degrees above the horizon
+    float power;      // muzzle speed
+    float flightTime; // seconds from launch to the target
+    FiringPath path;
+};
+
+// Firing solutions for a cannon at a fixed position.
+//
+// A shell is launched from the muzzle, BARREL_LENGTH out along the barrel, so
+// for a target (X, Y) from the pivot and an angle a the arc through it needs
+//   power^2 = g (X - B cos a)^2 / (2 cos a (X sin a - Y cos a))
+//   time^2  = 2 (X sin a - Y cos a) / (g cos a)
+// (the barrel drops out of the second). Of the angles that reach a target the
+// solver picks the one needing the least power: there power is stationary in
+// the angle, so aim errors move the shell least. Without the barrel that angle
+// is 45 degrees plus half the target's elevation; the barrel shifts it, so
+// Newton's method on 1 / power^2 finishes from there. If the least power is
+// under MIN_CANNON_POWER, Newton finds the angle where the power rises to it,
+// lower if the muzzle can get that low and higher otherwise. If the flight
+// outlasts PROJECTILE_LIFETIME, the shot is lowered to the angle that meets
+// it, which is closed form. A lower limit can still fail (the shot lowered to
+// the lifetime drops back under the power, or the muzzle passes the target),
+// so those lanes search the higher side too.
+//
+// An arc is concave, so one through a target above the ground never touches
+// the ground before it. Off the wall the shell keeps its vertical motion and
+// WALL_RESTITUTION of its horizontal speed, which is the direct shot at a
+// target mirrored behind the wall and stretched by 1 / WALL_RESTITUTION, so the
+// same equations solve it. It is only tried for targets no direct arc reaches.
+// Ground bounces are not searched: a bounce keeps at most half the speed, and
+// sweeps of every angle and power found no point a shell passes after one that
+// lacks a direct solution, away from the barrel itself.
+//
+// Angles are carried as h = tan(angle / 2), which makes the sine and cosine
+// rational, so the Newton loops are multiplies and divides over float blocks
+// that GCC vectorizes.
+class FiringSolver {
+public:
+    explicit FiringSolver(glm::vec2 cannonPosition) : cannon_(cannonPosition) {}
+
+    // Solution for one target
+    FiringSolution solve(glm::vec2 target) const {
+        FiringSolution solution;
+        solveRange(&target, 1, &solution);
+        return solution;
+    }
+
+    // Solutions for targets[0, count) into solutions, in parallel chunks
+    void solve(JobSystem& jobs, const glm::vec2* targets, std::size_t count, FiringSolution* solutions) const {
+        jobs.parallelFor(0, count, FIRING_GRAIN, [&](std::size_t begin, std::size_t end) {
+            solveRange(targets + begin, end - begin, solutions + begin);
+        });
+    }
+
+    // Solutions for targets[0, count) into solutions on the calling thread
+    void solveRange(const glm::vec2* targets, std::size_t count, FiringSolution* solutions) const {
+        for (std::size_t first = 0; first < count; first += FIRING_BLOCK) {
+            solveBlock(targets + first, std::min(count - first, FIRING_BLOCK), solutions + first);
+        }
+    }
+
+private:
+    // One block of lanes: target offsets in, angle, squared power and time out
+    struct Lanes {
+        float x[FIRING_BLOCK];
+        float y[FIRING_BLOCK];
+        float low[FIRING_BLOCK];       // least h with the muzzle short of the target and the arc above it
+        float h[FIRING_BLOCK];         // least-power angle
+        float limit[FIRING_BLOCK];     // power limit's angle, then the chosen shot's
+        float lower[FIRING_BLOCK];     // bounds of the power limit's search
+        float upper[FIRING_BLOCK];
+        float direction[FIRING_BLOCK]; // +1 below the least-power angle, -1 above
+        float lifetime[FIRING_BLOCK];  // highest h that lands within the lifetime
+        float power2[FIRING_BLOCK];
+        float time2[FIRING_BLOCK];
+        bool limited[FIRING_BLOCK];    // least power under MIN_CANNON_POWER
+        bool candidate[FIRING_BLOCK];  // reachable before the shot's checks
+        bool reachable[FIRING_BLOCK];
+    };
+
+    // h just under 90 degrees, where the cosine vanishes
+    static constexpr float MAX_H = 0.9998f;
+    // Relative slack on the limits for the last bits of rounding
+    static constexpr float LIMIT_SLACK = 1e-4f;
+
+    static float halfAngleTangent(float tangent) { return tangent / (1.0f + std::sqrt(1.0f + tangent * tangent)); }
+
+    void solveBlock(const glm::vec2* targets, std::size_t count, FiringSolution* solutions) const {
+        const float wallX = WINDOW_WIDTH - SHELL_RADIUS;
+        Lanes direct;
+        for (std::size_t i = 0; i < count; ++i) {
+            direct.x[i] = targets[i].x - cannon_.x;
+            direct.y[i] = targets[i].y - cannon_.y;
+            direct.reachable[i] = targets[i].y >= SHELL_RADIUS && targets[i].x <= wallX;
+        }
+        solveLanes(direct, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            writeSolution(direct, i, FiringPath::Direct, solutions[i]);
+        }
+
+        // Targets inside the walls that no direct arc reaches get another try off the wall
+        Lanes offWall;
+        std::size_t retried[FIRING_BLOCK];
+        std::size_t retries = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!direct.reachable[i] && targets[i].y >= SHELL_RADIUS && targets[i].x <= wallX) {
+                offWall.x[retries] = wallX + (wallX - targets[i].x) / WALL_RESTITUTION - cannon_.x;
+                offWall.y[retries] = targets[i].y - cannon_.y;
+                offWall.reachable[retries] = true;
+                retried[retries++] = i;
+            }
+        }
+        solveLanes(offWall, retries);
+        for (std::size_t k = 0; k < retries; ++k) {
+            writeSolution(offWall, k, FiringPath::OffWall, solutions[retried[k]]);
+        }
+    }
+
+    static void writeSolution(const Lanes& lanes, std::size_t i, FiringPath path, FiringSolution& solution) {
+        if (!lanes.reachable[i]) {
+            solution = FiringSolution{0.0f, 0.0f, 0.0f, FiringPath::Unreachable};
+            return;
+        }
+        float angle = 2.0f * std::atan(lanes.limit[i]) * 180.0f / PI;
+        float power = std::sqrt(lanes.power2[i]);
+        solution.angle = std::min(std::max(angle, MIN_CANNON_ANGLE), MAX_CANNON_ANGLE);
+        solution.power = std::min(std::max(power, MIN_CANNON_POWER), MAX_CANNON_POWER);
+        solution.flightTime = std::sqrt(lanes.time2[i]);
+        solution.path = path;
+    }
+
+    static void solveLanes(Lanes& lanes, std::size_t count) {
+        const float g = GRAVITY;
+        const float b = BARREL_LENGTH;
+        const float minPower2 = MIN_CANNON_POWER * MIN_CANNON_POWER;
+        const float maxTime2 = PROJECTILE_LIFETIME * PROJECTILE_LIFETIME;
+
+        // Start points and bounds. Targets behind the pivot have no arc.
+        for (std::size_t i = 0; i < count; ++i) {
+            float x = lanes.x[i];
+            float y = lanes.y[i];
+            if (!(x > 0.0f)) {
+                lanes.reachable[i] = false;
+                lanes.x[i] = x = 1.0f; // keeps the dead lane finite
+            }
+            float range = std::sqrt(x * x + y * y);
+            float aboveTarget = y / (range + x);
+            float pastMuzzle = x < b ? std::sqrt((b - x) / (b + x)) : 0.0f;
+            float low = std::min(std::max(std::max(aboveTarget, pastMuzzle), 0.0f) + 1e-6f, MAX_H);
+            lanes.low[i] = low;
+            lanes.h[i] = std::min(std::max(halfAngleTangent((range + y) / x), low), MAX_H);
+            // Highest angle that lands within the lifetime
+            lanes.lifetime[i] = halfAngleTangent((0.5f * g * maxTime2 + y) / x);
+            lanes.candidate[i] = lanes.reachable[i];
+        }
+
+        // Least power: the maximum of 1/power^2 = 2 cos a (X sin a - Y cos a) / (g u^2),
+        // u = X - B cos a. Its derivatives, with the factor 2 cos a / (g u^2) left
+        // out of both, have no poles inside the bounds.
+        float* __restrict h = lanes.h;
+        const float* __restrict xs = lanes.x;
+        const float* __restrict ys = lanes.y;
+        const float* __restrict lows = lanes.low;
+        for (int step = 0; step < FIRING_NEWTON_STEPS; ++step) {
+            for (std::size_t i = 0; i < count; ++i) {
+                float x = xs[i];
+                float y = ys[i];
+                float h2 = h[i] * h[i];
+                float c = (1.0f - h2) / (1.0f + h2);
+                float s = 2.0f * h[i] / (1.0f + h2);
+                float u = x - b * c;
+                float w = x * s - y * c;
+                float along = x * c + y * s;
+                float a = 2.0f * b * s / u + s / c;
+                float bend = 2.0f * b * (x * c - b) / (u * u) + 1.0f / (c * c);
+                float slope = along - w * a;
+                float curvature = w * (a * a - bend - 1.0f) - 2.0f * a * along;
+                float next = h[i] - slope * (1.0f + h2) / (2.0f * std::min(curvature, -1e-6f));
+                // With the muzzle right over the target (u = 0) the step is NaN;
+                // max(low, NaN) is low, where the least power then is
+                h[i] = std::min(std::max(lows[i], next), MAX_H);
+            }
+        }
+
+        // Power limit: a zero of 1/power^2 - 1/MIN_CANNON_POWER^2 below the
+        // least-power angle if the power there reaches the limit, above it
+        // otherwise. Newton starts from the outer end, where 1/power^2 is close
+        // to linear in the angle and power^2 itself has a pole.
+        float* __restrict limit = lanes.limit;
+        float* __restrict power2 = lanes.power2;
+        float* __restrict lower = lanes.lower;
+        float* __restrict upper = lanes.upper;
+        float* __restrict direction = lanes.direction;
+        bool* __restrict limited = lanes.limited;
+        for (std::size_t i = 0; i < count; ++i) {
+            float h2 = h[i] * h[i];
+            float c = (1.0f - h2) / (1.0f + h2);
+            float s = 2.0f * h[i] / (1.0f + h2);
+            float u = xs[i] - b * c;
+            power2[i] = g * u * u / (2.0f * c * (xs[i] * s - ys[i] * c));
+
+            float lowH2 = lows[i] * lows[i];
+            float lowC = (1.0f - lowH2) / (1.0f + lowH2);
+            float lowS = 2.0f * lows[i] / (1.0f + lowH2);
+            float lowU = xs[i] - b * lowC;
+            bool below = 2.0f * lowC * (xs[i] * lowS - ys[i] * lowC) * minPower2 <= g * lowU * lowU;
+            limited[i] = power2[i] < minPower2;
+            // Lanes within the limit search nothing: both bounds are the least-power angle
+            lower[i] = limited[i] & below ? lows[i] : h[i];
+            upper[i] = limited[i] & !below ? MAX_H : h[i];
+            direction[i] = below ? 1.0f : -1.0f;
+            limit[i] = below ? lower[i] : upper[i];
+        }
+        searchPowerLimit(lanes, count);
+        chooseShots(lanes, count);
+
+        // Limited lanes whose shot failed its checks try the other side of the
+        // least-power angle. The rest search nothing: both bounds are their shot.
+        bool retry = false;
+        for (std::size_t i = 0; i < count; ++i) {
+            bool other = limited[i] & lanes.candidate[i] & !lanes.reachable[i];
+            bool wasBelow = direction[i] > 0.0f;
+            lower[i] = other ? (wasBelow ? h[i] : lows[i]) : limit[i];
+            upper[i] = other ? (wasBelow ? MAX_H : h[i]) : limit[i];
+            direction[i] = other ? -direction[i] : direction[i];
+            limit[i] = other ? (wasBelow ? upper[i] : lower[i]) : limit[i];
+            retry |= other;
+        }
+        if (retry) {
+            searchPowerLimit(lanes, count);
+            chooseShots(lanes, count);
+        }
+    }
+
+    // Newton on the power limit within [lower, upper], from limit
+    static void searchPowerLimit(Lanes& lanes, std::size_t count) {
+        const float g = GRAVITY;
+        const float b = BARREL_LENGTH;
+        const float minPower2 = MIN_CANNON_POWER * MIN_CANNON_POWER;
+        float* __restrict limit = lanes.limit;
+        float* __restrict lower = lanes.lower;
+        float* __restrict upper = lanes.upper;
+        const float* __restrict direction = lanes.direction;
+        const float* __restrict xs = lanes.x;
+        const float* __restrict ys = lanes.y;
+        for (int step = 0; step < FIRING_NEWTON_STEPS; ++step) {
+            for (std::size_t i = 0; i < count; ++i) {
+                float x = xs[i];
+                float y = ys[i];
+                float at = limit[i];
+                float h2 = at * at;
+                float c = (1.0f - h2) / (1.0f + h2);
+                float s = 2.0f * at / (1.0f + h2);
+                float u = x - b * c;
+                float w = x * s - y * c;
+                float scale = 2.0f * c / (g * u * u);
+                float inverse = scale * w - 1.0f / minPower2;
+                float slope = scale * ((x * c + y * s) - w * (2.0f * b * s / u + s / c));
+                // 1/power^2 rises towards the least-power angle from either side,
+                // so the sign of inverse says which bound moves. A step that
+                // leaves the bounds bisects them instead.
+                float side = direction[i];
+                bool past = side * inverse > 0.0f;
+                float low = past ? lower[i] : at;
+                float high = past ? at : upper[i];
+                float next = at - inverse * (1.0f + h2) / (2.0f * side * std::max(side * slope, 1e-9f));
+                bool inside = (next >= low) & (next <= high);
+                lower[i] = low;
+                upper[i] = high;
+                limit[i] = inside ? next : 0.5f * (low + high);
+            }
+        }
+    }
+
+    // The shot: least power or the power limit, lowered to the time limit;
+    // reachable if it passes the muzzle and the power and time limits
+    static void chooseShots(Lanes& lanes, std::size_t count) {
+        const float g = GRAVITY;
+        const float b = BARREL_LENGTH;
+        const float minPower2 = MIN_CANNON_POWER * MIN_CANNON_POWER;
+        const float maxPower2 = MAX_CANNON_POWER * MAX_CANNON_POWER;
+        const float maxTime2 = PROJECTILE_LIFETIME * PROJECTILE_LIFETIME;
+        float* __restrict limit = lanes.limit;
+        float* __restrict power2 = lanes.power2;
+        float* __restrict time2 = lanes.time2;
+        bool* __restrict reachable = lanes.reachable;
+        const float* __restrict lifetime = lanes.lifetime;
+        const bool* __restrict candidate = lanes.candidate;
+        const float* __restrict xs = lanes.x;
+        const float* __restrict ys = lanes.y;
+        const float* __restrict lows = lanes.low;
+        for (std::size_t i = 0; i < count; ++i) {
+            float chosen = std::min(limit[i], lifetime[i]);
+            float h2 = chosen * chosen;
+            float c = (1.0f - h2) / (1.0f + h2);
+            float s = 2.0f * chosen / (1.0f + h2);
+            float u = xs[i] - b * c;
+            float w = xs[i] * s - ys[i] * c;
+            limit[i] = chosen;
+            power2[i] = g * u * u / (2.0f * c * w);
+            time2[i] = 2.0f * w / (g * c);
+            reachable[i] = candidate[i] & (chosen >= lows[i]) & (u > 0.0f) & (w > 0.0f) &
+                           (power2[i] <= maxPower2 * (1.0f + LIMIT_SLACK)) &
+                           (power2[i] >= minPower2 * (1.0f - LIMIT_SLACK)) &
+                           (time2[i] <= maxTime2 * (1.0f + LIMIT_SLACK));
+        }
+    }
+
+    glm::vec2 cannon_;
+};
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "firing_solution.h"
+#include "job_system.h"
+#include "projectile.h"
+#include "projectile_store.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+// Firing table file: one shot per (angle, power) grid point, flown with the
+// stepped simulation's physics, laid out to be mmap'd and read in place.
+//   FiringTableHeader, then FIRING_TABLE_COLUMNS float columns, each starting
+//   on a PROJECTILE_ALIGNMENT boundary. Shot k is angle k / powerCount and
+//   power k % powerCount of the grid.
+// physicsHash covers the grid, the cannon, the step and the physics itself
+// (see firingPhysicsHash); a table whose hash differs is rebuilt.
+const char FIRING_TABLE_MAGIC[4] = {'C', 'N', 'F', 'T'};
+const std::uint32_t FIRING_TABLE_VERSION = 2;
+const std::uint32_t FIRING_TABLE_BYTE_ORDER = 0x01020304u;
+
+// Grid: every half degree and every half unit of power across the aim limits
+const std::uint32_t FIRING_TABLE_ANGLES = 181;
+const std::uint32_t FIRING_TABLE_POWERS = 181;
+
+// Shots per parallel build chunk; a shot is up to a lifetime of steps
+const std::size_t FIRING_TABLE_GRAIN = 64;
+
+// range, apex, flightTime, bounceX, bounceY, landed (1 or 0)
+const std::size_t FIRING_TABLE_COLUMNS = 6;
+
+struct FiringTableHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t angleCount;
+    std::uint32_t powerCount;
+    std::uint32_t columnCount;
+    std::uint64_t physicsHash;
+    double stepSeconds;
+    float minAngle;
+    float maxAngle;
+    float minPower;
+    float maxPower;
+    float cannonX;
+    float cannonY;
+    std::uint64_t columnOffsets[FIRING_TABLE_COLUMNS]; // from the start of the file
+};
+
+static_assert(std::is_trivially_copyable<FiringTableHeader>::value, "firing table header is written as bytes");
+
+// One shot, from launch to its first touch of the ground. Shots still in the
+// air when their lifetime ends record where they were then, with flightTime
+// PROJECTILE_LIFETIME and landed false.
+struct FiringTableEntry {
+    float range;      // x of the first ground contact, from the cannon's pivot
+    float apex;       // highest y of the shell's centre before then
+    float flightTime; // seconds from launch to the first ground contact
+    float bounceX;    // first contact with the ground or the wall
+    float bounceY;
+    bool landed;      // whether it touched the ground within its lifetime
+};
+
+inline std::uint64_t hashFiringBytes(std::uint64_t hash, const void* data, std::size_t bytes) {
+    const unsigned char* values = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < bytes; ++i) {
+        hash = (hash ^ values[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// FNV-1a over everything a table depends on. Besides the constants it flies a
+// few probe shots through Projectile::update for a whole lifetime and hashes
+// every step, so any change to gravity, bounces, the barrel or the step, in a
+// constant or in code, gives a new hash. The build's CANNON_FIXED_POINT is in
+// it too, so float and fixed-point builds never share a table.
+inline std::uint64_t firingPhysicsHash(glm::vec2 cannon, double stepSeconds) {
+    std::uint64_t hash = 14695981039346656037ull;
+    const std::uint32_t layout[] = {FIRING_TABLE_VERSION, FIRING_TABLE_ANGLES, FIRING_TABLE_POWERS,
+                                    static_cast<std::uint32_t>(FIRING_TABLE_COLUMNS), CANNON_FIXED_POINT};
+    const float constants[] = {MIN_CANNON_ANGLE, MAX_CANNON_ANGLE, MIN_CANNON_POWER, MAX_CANNON_POWER,
+                               GRAVITY, PROJECTILE_LIFETIME, BARREL_LENGTH, SHELL_RADIUS, WALL_RESTITUTION,
+                               static_cast<float>(WINDOW_WIDTH), cannon.x, cannon.y};
+    hash = hashFiringBytes(hash, layout, sizeof(layout));
+    hash = hashFiringBytes(hash, constants, sizeof(constants));
+    hash = hashFiringBytes(hash, &stepSeconds, sizeof(stepSeconds));
+
+    const float probes[][2] = {{10.0f, 100.0f}, {30.0f, 90.0f}, {45.0f, 55.0f}, {80.0f, 30.0f}, {60.0f, 10.0f}};
+    float deltaTime = static_cast<float>(stepSeconds);
+    unsigned long long steps = stepsToExpire(deltaTime);
+    for (const auto& probe : probes) {
+        Projectile projectile = launchProjectile(cannon, probe[0], probe[1]);
+        for (unsigned long long step = 0; step < steps && projectile.active; ++step) {
+            projectile.update(deltaTime);
+            const float state[] = {projectile.position.x, projectile.position.y, projectile.velocity.x,
+                                   projectile.velocity.y, projectile.timeAlive};
+            hash = hashFiringBytes(hash, state, sizeof(state));
+        }
+    }
+    return hash;
+}
+
+// Flies one shot with Projectile::update, the game's own step, stopping at its
+// first ground impact instead of bouncing there. Wall impacts bounce as usual;
+// the first impact of either kind is the entry's bounce point.
+inline FiringTableEntry flyFiringTableShot(glm::vec2 cannon, float angle, float power, float deltaTime) {
+    Projectile shell = launchProjectile(cannon, angle, power);
+    FiringTableEntry entry;
+    entry.apex = shell.position.y;
+    entry.landed = true;
+    entry.bounceX = NAN;
+    entry.bounceY = NAN;
+    // Same tick count as the shell's lifetime timer at this rate
+    unsigned long long steps = stepsToExpire(deltaTime);
+    for (unsigned long long step = 0; step < steps; ++step) {
+        // Peak of this step's arc, if it has one
+        float vy = shell.velocity.y;
+        if (vy > 0.0f && vy - GRAVITY * deltaTime <= 0.0f) {
+            entry.apex = std::fmax(entry.apex, shell.position.y + vy * vy / (2.0f * GRAVITY));
+        }
+        bool landed = shell.updateUntil(deltaTime, [&](float x, float y, bool ground, float elapsed) {
+            if (std::isnan(entry.bounceX)) {
+                entry.bounceX = x;
+                entry.bounceY = y;
+            }
+            if (ground) {
+                entry.range = x - cannon.x;
+                entry.flightTime = step * deltaTime + elapsed;
+            }
+            return ground;
+        });
+        entry.apex = std::fmax(entry.apex, shell.position.y);
+        if (landed) {
+            return entry;
+        }
+    }
+    entry.range = shell.position.x - cannon.x;
+    entry.flightTime = PROJECTILE_LIFETIME;
+    entry.landed = false;
+    if (std::isnan(entry.bounceX)) {
+        entry.bounceX = shell.position.x;
+        entry.bounceY = shell.position.y;
+    }
+    return entry;
+}
+
+// A firing table mapped read-only. lookup() interpolates between the four grid
+// shots around an aim; aimForRange() inverts range for a fixed angle. Both
+// read the mapping in place, so a table costs nothing until it is used.
+class FiringTable {
+public:
+    FiringTable() : data_(nullptr), size_(0), rebuilt_(false) {}
+    ~FiringTable() { close(); }
+
+    FiringTable(const FiringTable&) = delete;
+    FiringTable& operator=(const FiringTable&) = delete;
+
+    // Maps `path` if it was built for this cannon, step and physics; otherwise
+    // (or if it is missing) builds the table, writes it there and maps that
+    bool load(const std::string& path, JobSystem& jobs, glm::vec2 cannon, double stepSeconds) {
+        std::uint64_t physicsHash = firingPhysicsHash(cannon, stepSeconds);
+        rebuilt_ = false;
+        if (open(path, physicsHash)) {
+            return true;
+        }
+        rebuilt_ = true;
+        return build(path, jobs, cannon, stepSeconds, physicsHash) && open(path, physicsHash);
+    }
+
+    // Flies every grid shot in parallel and writes the table to `path`, through
+    // a temporary file so a reader never maps half a table
+    static bool build(const std::string& path, JobSystem& jobs, glm::vec2 cannon, double stepSeconds,
+                      std::uint64_t physicsHash) {
+        const std::size_t shots = std::size_t(FIRING_TABLE_ANGLES) * FIRING_TABLE_POWERS;
+        std::vector<float> columns[FIRING_TABLE_COLUMNS];
+        for (std::vector<float>& column : columns) {
+            column.resize(shots);
+        }
+        float deltaTime = static_cast<float>(stepSeconds);
+        jobs.parallelFor(0, shots, FIRING_TABLE_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                FiringTableEntry entry = flyFiringTableShot(cannon, gridAngle(k / FIRING_TABLE_POWERS),
+                                                            gridPower(k % FIRING_TABLE_POWERS), deltaTime);
+                columns[0][k] = entry.range;
+                columns[1][k] = entry.apex;
+                columns[2][k] = entry.flightTime;
+                columns[3][k] = entry.bounceX;
+                columns[4][k] = entry.bounceY;
+                columns[5][k] = entry.landed ? 1.0f : 0.0f;
+            }
+        });
+
+        FiringTableHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, FIRING_TABLE_MAGIC, sizeof(header.magic));
+        header.version = FIRING_TABLE_VERSION;
+        header.byteOrder = FIRING_TABLE_BYTE_ORDER;
+        header.angleCount = FIRING_TABLE_ANGLES;
+        header.powerCount = FIRING_TABLE_POWERS;
+        header.columnCount = FIRING_TABLE_COLUMNS;
+        header.physicsHash = physicsHash;
+        header.stepSeconds = stepSeconds;
+        header.minAngle = MIN_CANNON_ANGLE;
+        header.maxAngle = MAX_CANNON_ANGLE;
+        header.minPower = MIN_CANNON_POWER;
+        header.maxPower = MAX_CANNON_POWER;
+        header.cannonX = cannon.x;
+        header.cannonY = cannon.y;
+        std::uint64_t offset = alignOffset(sizeof(header));
+        for (std::size_t k = 0; k < FIRING_TABLE_COLUMNS; ++k) {
+            header.columnOffsets[k] = offset;
+            offset = alignOffset(offset + shots * sizeof(float));
+        }
+
+        std::string temporaryPath = path + ".tmp";
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Failed to open firing table " << temporaryPath << std::endl;
+            return false;
+        }
+        static const char padding[PROJECTILE_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::uint64_t written = sizeof(header);
+        for (std::size_t k = 0; k < FIRING_TABLE_COLUMNS; ++k) {
+            file.write(padding, static_cast<std::streamsize>(header.columnOffsets[k] - written));
+            file.write(reinterpret_cast<const char*>(columns[k].data()),
+                       static_cast<std::streamsize>(shots * sizeof(float)));
+            written = header.columnOffsets[k] + shots * sizeof(float);
+        }
+        file.write(padding, static_cast<std::streamsize>(alignOffset(written) - written));
+        if (!file.flush()) {
+            std::cerr << "Failed to write firing table " << temporaryPath << std::endl;
+            return false;
+        }
+        file.close();
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Failed to replace firing table " << path << std::endl;
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Maps `path` if it holds a table with this physics hash. A missing or
+    // stale table is not an error here; load() rebuilds it.
+    bool open(const std::string& path, std::uint64_t physicsHash) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(FiringTableHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Failed to map firing table " << path << std::endl;
+            return false;
+        }
+        data_ = static_cast<const unsigned char*>(mapping);
+        size_ = info.st_size;
+        if (!validate(physicsHash)) {
+            close();
+            return false;
+        }
+        const FiringTableHeader& saved = header();
+        for (std::size_t k = 0; k < FIRING_TABLE_COLUMNS; ++k) {
+            columns_[k] = reinterpret_cast<const float*>(data_ + saved.columnOffsets[k]);
+        }
+        return true;
+    }
+
+    void close() {
+        if (data_) {
+            munmap(const_cast<unsigned char*>(data_), size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    bool isOpen() const { return data_ != nullptr; }
+    // Whether the last load() had to build the table
+    bool rebuilt() const { return rebuilt_; }
+    const FiringTableHeader& header() const { return *reinterpret_cast<const FiringTableHeader*>(data_); }
+    std::size_t shots() const { return std::size_t(header().angleCount) * header().powerCount; }
+
+    // The shot at an aim, interpolated bilinearly between grid shots; aims
+    // outside the limits are clamped to them. It has landed only if all four
+    // grid shots did: an interpolated range that involves a shot still in the
+    // air is not a point of impact.
+    FiringTableEntry lookup(float angle, float power) const {
+        std::size_t row;
+        std::size_t column;
+        float rowWeight;
+        float columnWeight;
+        locate(angle, MIN_CANNON_ANGLE, MAX_CANNON_ANGLE, header().angleCount, row, rowWeight);
+        locate(power, MIN_CANNON_POWER, MAX_CANNON_POWER, header().powerCount, column, columnWeight);
+        std::size_t k = row * header().powerCount + column;
+        std::size_t below = k + header().powerCount;
+        float values[FIRING_TABLE_COLUMNS - 1];
+        for (std::size_t c = 0; c < FIRING_TABLE_COLUMNS - 1; ++c) {
+            const float* column = columns_[c];
+            float upper = column[k] + (column[k + 1] - column[k]) * columnWeight;
+            float lower = column[below] + (column[below + 1] - column[below]) * columnWeight;
+            values[c] = upper + (lower - upper) * rowWeight;
+        }
+        const float* landed = columns_[FIRING_TABLE_COLUMNS - 1];
+        bool allLanded = landed[k] != 0.0f && landed[k + 1] != 0.0f && landed[below] != 0.0f &&
+                         landed[below + 1] != 0.0f;
+        return FiringTableEntry{values[0], values[1], values[2], values[3], values[4], allLanded};
+    }
+
+    // Least power that first lands `range` from the pivot at `angle`, from the
+    // interpolated ranges along the power axis; false if no power does
+    bool aimForRange(float angle, float range, float& power) const {
+        std::size_t row;
+        float rowWeight;
+        locate(angle, MIN_CANNON_ANGLE, MAX_CANNON_ANGLE, header().angleCount, row, rowWeight);
+        const std::uint32_t powers = header().powerCount;
+        const float* ranges = columns_[0] + row * powers;
+        const float* nextRanges = ranges + powers;
+        float previous = ranges[0] + (nextRanges[0] - ranges[0]) * rowWeight;
+        if (previous >= range) {
+            power = MIN_CANNON_POWER;
+            return previous == range;
+        }
+        for (std::uint32_t j = 1; j < powers; ++j) {
+            float current = ranges[j] + (nextRanges[j] - ranges[j]) * rowWeight;
+            if (current >= range) {
+                float weight = (range - previous) / (current - previous);
+                power = gridPower(j - 1) + weight * (gridPower(j) - gridPower(j - 1));
+                return true;
+            }
+            previous = current;
+        }
+        return false;
+    }
+
+    static float gridAngle(std::size_t i) {
+        return MIN_CANNON_ANGLE + (MAX_CANNON_ANGLE - MIN_CANNON_ANGLE) * i / (FIRING_TABLE_ANGLES - 1);
+    }
+    static float gridPower(std::size_t j) {
+        return MIN_CANNON_POWER + (MAX_CANNON_POWER - MIN_CANNON_POWER) * j / (FIRING_TABLE_POWERS - 1);
+    }
+
+private:
+    static std::uint64_t alignOffset(std::uint64_t offset) {
+        return (offset + PROJECTILE_ALIGNMENT - 1) / PROJECTILE_ALIGNMENT * PROJECTILE_ALIGNMENT;
+    }
+
+    // Grid cell [index, index + 1] holding value and its position in the cell
+    static void locate(float value, float low, float high, std::uint32_t count, std::size_t& index, float& weight) {
+        float position = (std::min(std::max(value, low), high) - low) / (high - low) * (count - 1);
+        index = std::min(static_cast<std::size_t>(position), std::size_t(count - 2));
+        weight = position - index;
+    }
+
+    // The header must match this build's grid and physics, and every column fit in the file
+    bool validate(std::uint64_t physicsHash) const {
+        const FiringTableHeader& saved = header();
+        if (std::memcmp(saved.magic, FIRING_TABLE_MAGIC, sizeof(saved.magic)) != 0 ||
+            saved.version != FIRING_TABLE_VERSION || saved.byteOrder != FIRING_TABLE_BYTE_ORDER ||
+            saved.physicsHash != physicsHash || saved.angleCount != FIRING_TABLE_ANGLES ||
+            saved.powerCount != FIRING_TABLE_POWERS || saved.columnCount != FIRING_TABLE_COLUMNS) {
+            return false;
+        }
+        for (std::size_t k = 0; k < FIRING_TABLE_COLUMNS; ++k) {
+            std::uint64_t offset = saved.columnOffsets[k];
+            if (offset % PROJECTILE_ALIGNMENT != 0 || offset > size_ ||
+                (size_ - offset) / sizeof(float) < shots()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const unsigned char* data_;
+    std::size_t size_;
+    bool rebuilt_;
+    const float* columns_[FIRING_TABLE_COLUMNS];
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+// Fixed-point simulation mode, chosen at compile time:
+//   0  - float simulation (default)
+//   16 - Q16.16 positions, velocities and constants (-DCANNON_FIXED_POINT=16)
+//   32 - Q32.32                                      (-DCANNON_FIXED_POINT=32)
+// Integer arithmetic gives the same bits on every compiler, flag set and CPU,
+// so two fixed-point runs fed the same inputs end in the same state.
+#ifndef CANNON_FIXED_POINT
+#define CANNON_FIXED_POINT 0
+#endif
+
+// Signed fixed-point number with FracBits fraction bits stored in Raw; Wide and
+// WideUnsigned hold products, shifted dividends and square roots. Add, subtract
+// and multiply wrap like the unsigned integers they are computed in (never
+// undefined behaviour); division saturates, since a time of impact with a
+// near-zero velocity is legitimately huge. Products round towards negative infinity.
+template <int FracBits, typename Raw, typename Wide, typename WideUnsigned>
+class Fixed {
+public:
+    static const int FRACTION_BITS = FracBits;
+    typedef Raw RawType;
+
+    constexpr Fixed() : raw_(0) {}
+
+    static constexpr Fixed fromRaw(Raw raw) { return Fixed(raw, 0); }
+    static constexpr Fixed fromInt(int value) { return Fixed(static_cast<Raw>(static_cast<Wide>(value) * ONE), 0); }
+
+    // Nearest fixed-point value. Exact for every float input: scaling by a power
+    // of two in double is exact and llround has no rounding-mode dependence.
+    static Fixed fromFloat(float value) {
+        return Fixed(static_cast<Raw>(std::llround(static_cast<double>(value) * static_cast<double>(ONE))), 0);
+    }
+
+    static constexpr Fixed max() { return Fixed(std::numeric_limits<Raw>::max(), 0); }
+
+    Raw raw() const { return raw_; }
+    // Scaling by a power of two is exact, so this is the one rounding to float
+    float toFloat() const { return static_cast<float>(static_cast<double>(raw_) * (1.0 / static_cast<double>(ONE))); }
+
+    Fixed operator+(Fixed other) const { return Fixed(wrap(toUnsigned(raw_) + toUnsigned(other.raw_)), 0); }
+    Fixed operator-(Fixed other) const { return Fixed(wrap(toUnsigned(raw_) - toUnsigned(other.raw_)), 0); }
+    Fixed operator-() const { return Fixed(wrap(Unsigned(0) - toUnsigned(raw_)), 0); }
+    Fixed operator*(Fixed other) const {
+        return Fixed(static_cast<Raw>((static_cast<Wide>(raw_) * other.raw_) >> FracBits), 0);
+    }
+    Fixed operator/(Fixed other) const {
+        if (other.raw_ == 0) {
+            return raw_ < 0 ? Fixed(std::numeric_limits<Raw>::min(), 0) : max();
+        }
+        Wide quotient = (static_cast<Wide>(raw_) * ONE) / other.raw_;
+        if (quotient > static_cast<Wide>(std::numeric_limits<Raw>::max())) {
+            return max();
+        }
+        if (quotient < static_cast<Wide>(std::numeric_limits<Raw>::min())) {
+            return Fixed(std::numeric_limits<Raw>::min(), 0);
+        }
+        return Fixed(static_cast<Raw>(quotient), 0);
+    }
+
+    Fixed& operator+=(Fixed other) { return *this = *this + other; }
+    Fixed& operator-=(Fixed other) { return *this = *this - other; }
+    Fixed& operator*=(Fixed other) { return *this = *this * other; }
+
+    bool operator==(Fixed other) const { return raw_ == other.raw_; }
+    bool operator!=(Fixed other) const { return raw_ != other.raw_; }
+    bool operator<(Fixed other) const { return raw_ < other.raw_; }
+    bool operator<=(Fixed other) const { return raw_ <= other.raw_; }
+    bool operator>(Fixed other) const { return raw_ > other.raw_; }
+    bool operator>=(Fixed other) const { return raw_ >= other.raw_; }
+
+    // Largest value whose square does not exceed this one; 0 for negatives
+    Fixed sqrt() const {
+        if (raw_ <= 0) {
+            return Fixed();
+        }
+        // sqrt(raw / 2^F) * 2^F = sqrt(raw * 2^F), by the digit-by-digit method
+        WideUnsigned value = static_cast<WideUnsigned>(raw_) << FracBits;
+        WideUnsigned root = 0;
+        WideUnsigned bit = static_cast<WideUnsigned>(1) << (sizeof(Wide) * 8 - 2);
+        while (bit > value) {
+            bit >>= 2;
+        }
+        while (bit != 0) {
+            if (value >= root + bit) {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return Fixed(static_cast<Raw>(root), 0);
+    }
+
+private:
+    typedef typename std::make_unsigned<Raw>::type Unsigned;
+    static constexpr Wide ONE = static_cast<Wide>(1) << FracBits;
+
+    constexpr Fixed(Raw raw, int) : raw_(raw) {}
+
+    static Unsigned toUnsigned(Raw raw) { return static_cast<Unsigned>(raw); }
+    static Raw wrap(Unsigned value) { return static_cast<Raw>(value); }
+
+    Raw raw_;
+};
+
+__extension__ typedef __int128 FixedInt128;
+__extension__ typedef unsigned __int128 FixedUInt128;
+
+typedef Fixed<16, std::int32_t, std::int64_t, std::uint64_t> Q16_16;
+typedef Fixed<32, std::int64_t, FixedInt128, FixedUInt128> Q32_32;
+
+#if CANNON_FIXED_POINT == 16
+typedef Q16_16 SimFixed;
+#elif CANNON_FIXED_POINT == 32
+typedef Q32_32 SimFixed;
+#elif CANNON_FIXED_POINT != 0
+#error "CANNON_FIXED_POINT must be 0, 16 or 32"
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "fixed_point.h"
+#include "projectile.h"
+#include <cstddef>
+#include <cstdint>
+
+// Projectile physics in a fixed-point type F (Q16_16 or Q32_32): the same exact
+// arc, swept bounces and settling rule as projectile.h, in integer arithmetic.
+// Only the float constants are converted, once, so results depend on nothing
+// but the inputs.
+
+// Physics constants in F
+template <typename F>
+struct FixedConstants {
+    F gravity = F::fromFloat(GRAVITY);
+    F halfGravity = F::fromFloat(0.5f * GRAVITY);
+    F twoGravity = F::fromFloat(2.0f * GRAVITY);
+    F wallX = F::fromInt(WINDOW_WIDTH);
+    F groundDamping = F::fromFloat(0.5f);
+    F groundBounce = F::fromFloat(0.7f);
+    F wallBounce = F::fromFloat(-0.7f);
+    F one = F::fromInt(1);
+    F two = F::fromInt(2);
+};
+
+// Columns of a fixed-point projectile state; `active` is shared with the float store
+template <typename F>
+struct FixedProjectileSpan {
+    F* posX;
+    F* posY;
+    F* velX;
+    F* velY;
+    const F* radius;
+    std::uint8_t* active;
+    std::size_t count;
+
+    FixedProjectileSpan subspan(std::size_t offset, std::size_t length) const {
+        return FixedProjectileSpan{posX + offset, posY + offset, velX + offset, velY + offset,
+                                   radius + offset, active + offset, length};
+    }
+};
+
+// One shell's launch state
+template <typename F>
+struct FixedProjectile {
+    F x;
+    F y;
+    F velX;
+    F velY;
+    F radius;
+};
+
+template <typename F>
+inline void flyFixed(F& px, F& py, F vx, F& vy, F t, const FixedConstants<F>& c) {
+    px = px + vx * t;
+    py = py + vy * t - c.halfGravity * t * t;
+    vy = vy - c.gravity * t;
+}
+
+// See timeToGround; a zero denominator (rounding at a grazing contact) means now
+template <typename F>
+inline F timeToGroundFixed(F height, F vy, const FixedConstants<F>& c) {
+    F discriminant = vy * vy + c.twoGravity * height;
+    if (discriminant < F() || (height <= F() && vy <= F())) {
+        return F();
+    }
+    F root = discriminant.sqrt();
+    if (vy > F()) {
+        return (vy + root) / c.gravity;
+    }
+    F denominator = root - vy;
+    return denominator > F() ? c.two * height / denominator : F();
+}
+
+template <typename F>
+inline F timeToWallFixed(F px, F vx, F r, const FixedConstants<F>& c) {
+    if (!(vx > F())) {
+        return F::max();
+    }
+    F time = (c.wallX - r - px) / vx;
+    return time > F() ? time : F();
+}
+
+// See sweepProjectile
+template <typename F>
+inline bool sweepFixed(F& px, F& py, F& vx, F& vy, F r, F deltaTime, const FixedConstants<F>& c) {
+    F remaining = deltaTime;
+    for (int bounce = 0;; ++bounce) {
+        F groundTime = timeToGroundFixed(py - r, vy, c);
+        F wallTime = timeToWallFixed(px, vx, r, c);
+        F impactTime = groundTime < wallTime ? groundTime : wallTime;
+        if (impactTime >= remaining || bounce == MAX_BOUNCES_PER_STEP) {
+            flyFixed(px, py, vx, vy, remaining, c);
+            if (py < r) {
+                py = r;
+            }
+            if (vx > F() && px > c.wallX - r) {
+                px = c.wallX - r;
+            }
+            return true;
+        }
+        flyFixed(px, py, vx, vy, impactTime, c);
+        remaining -= impactTime;
+
+        if (groundTime <= wallTime) {
+            py = r;
+            vx *= c.groundDamping;
+            vy *= c.groundDamping;
+            if (vx * vx + vy * vy < c.one) {
+                return false;
+            }
+            vy = -vy * c.groundBounce;
+        } else {
+            px = c.wallX - r;
+            vx *= c.wallBounce;
+        }
+    }
+}
+
+// Fixed-point Projectile::update(span, dt), without timeAlive (callers that
+// keep the float store alongside advance that themselves)
+template <typename F>
+inline void updateFixedProjectiles(const FixedProjectileSpan<F>& span, F deltaTime, const FixedConstants<F>& c) {
+    for (std::size_t i = 0; i < span.count; ++i) {
+        if (!span.active[i]) {
+            continue;
+        }
+        F px = span.posX[i];
+        F py = span.posY[i];
+        F vx = span.velX[i];
+        F vy = span.velY[i];
+        F r = span.radius[i];
+        F endX = px;
+        F endY = py;
+        F endVy = vy;
+        flyFixed(endX, endY, vx, endVy, deltaTime, c);
+        if (endY > r && endX < c.wallX - r) {
+            px = endX;
+            py = endY;
+            vy = endVy;
+        } else if (!sweepFixed(px, py, vx, vy, r, deltaTime, c)) {
+            span.active[i] = 0;
+        }
+        span.posX[i] = px;
+        span.posY[i] = py;
+        span.velX[i] = vx;
+        span.velY[i] = vy;
+    }
+}
+
+// sin and cos of an angle in [0, 90] degrees by their Taylor series to x^11,
+// well inside a Q16.16 ulp over that range
+template <typename F>
+inline void fixedSinCos(F degrees, F& sine, F& cosine) {
+    const F radiansPerDegree = F::fromFloat(PI / 180.0f);
+    F x = degrees * radiansPerDegree;
+    F x2 = x * x;
+    sine = x * (F::fromInt(1) + x2 * (F::fromFloat(-1.0f / 6.0f) + x2 * (F::fromFloat(1.0f / 120.0f) +
+           x2 * (F::fromFloat(-1.0f / 5040.0f) + x2 * (F::fromFloat(1.0f / 362880.0f) +
+           x2 * F::fromFloat(-1.0f / 39916800.0f))))));
+    cosine = F::fromInt(1) + x2 * (F::fromFloat(-0.5f) + x2 * (F::fromFloat(1.0f / 24.0f) +
+             x2 * (F::fromFloat(-1.0f / 720.0f) + x2 * (F::fromFloat(1.0f / 40320.0f) +
+             x2 * F::fromFloat(-1.0f / 3628800.0f)))));
+}
+
+// Fixed-point launchProjectile; angle in [0, 90] degrees
+template <typename F>
+inline FixedProjectile<F> launchFixedProjectile(F cannonX, F cannonY, F angle, F power) {
+    F sine;
+    F cosine;
+    fixedSinCos(angle, sine, cosine);
+    F barrel = F::fromFloat(BARREL_LENGTH);
+    return FixedProjectile<F>{cannonX + barrel * cosine, cannonY + barrel * sine,
+                              power * cosine, power * sine, F::fromFloat(SHELL_RADIUS)};
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+// Per-phase frame profiler: CPU timers and GL timestamp queries per main-loop
+// phase, kept for the last HISTORY_FRAMES frames. Built when NDEBUG is not
+// defined or when compiling with -DCANNON_PROFILE; otherwise PROFILE_SCOPE
+// expands to nothing and none of this is compiled.
+#if !defined(NDEBUG) || defined(CANNON_PROFILE)
+#define CANNON_PROFILING 1
+#else
+#define CANNON_PROFILING 0
+#endif
+
+#if CANNON_PROFILING
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+enum class FramePhase { Input, Update, Collide, Compact, Background, Cannon, Projectiles, Overlay, Swap, Count };
+const int FRAME_PHASE_COUNT = static_cast<int>(FramePhase::Count);
+
+inline const char* framePhaseName(FramePhase phase) {
+    switch (phase) {
+    case FramePhase::Input: return "input";
+    case FramePhase::Update: return "update";
+    case FramePhase::Collide: return "collide";
+    case FramePhase::Compact: return "compact";
+    case FramePhase::Background: return "background";
+    case FramePhase::Cannon: return "cannon";
+    case FramePhase::Projectiles: return "projectiles";
+    case FramePhase::Overlay: return "overlay";
+    case FramePhase::Swap: return "swap";
+    default: return "?";
+    }
+}
+
+// Only phases that issue GL commands get GPU timestamps
+inline bool framePhaseUsesGpu(FramePhase phase) {
+    return phase == FramePhase::Background || phase == FramePhase::Cannon ||
+           phase == FramePhase::Projectiles || phase == FramePhase::Overlay;
+}
+
+class FrameProfiler {
+public:
+    static const int HISTORY_FRAMES = 240;
+    // Frames a set of timestamp queries gets to resolve before it is reused;
+    // results that are still pending then are dropped rather than waited for
+    static const int QUERY_LATENCY = 4;
+    // Percentiles are recomputed this often, not every frame
+    static const int PERCENTILE_INTERVAL = 30;
+
+    struct FrameSample {
+        float frameMs;
+        float cpuMs[FRAME_PHASE_COUNT];
+        float gpuMs[FRAME_PHASE_COUNT]; // -1 until the frame's queries resolve
+    };
+
+    struct Percentiles {
+        float p50, p95, p99;
+    };
+
+    // Starts the scope's phase on construction and ends it on destruction
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, FramePhase phase) : profiler_(profiler), phase_(phase) {
+            profiler_.beginPhase(phase_);
+        }
+        ~Scope() { profiler_.endPhase(phase_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler& profiler_;
+        FramePhase phase_;
+    };
+
+    FrameProfiler() : frame_(0), history_(HISTORY_FRAMES), gpuReady_(false), percentiles_{0.0f, 0.0f, 0.0f} {
+        for (int set = 0; set < QUERY_LATENCY; ++set) {
+            querySets_[set].frame = 0;
+            querySets_[set].issued = 0;
+        }
+    }
+
+    ~FrameProfiler() { destroyGpu(); }
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    // Needs a current GL context with timer queries; without one only CPU times are kept
+    bool initGpu() {
+        if (!GLEW_VERSION_3_3 && !GLEW_ARB_timer_query) {
+            return false;
+        }
+        for (int set = 0; set < QUERY_LATENCY; ++set) {
+            glGenQueries(2 * FRAME_PHASE_COUNT, querySets_[set].queries);
+            querySets_[set].issued = 0;
+        }
+        gpuReady_ = true;
+        return true;
+    }
+
+    void destroyGpu() {
+        if (gpuReady_) {
+            for (int set = 0; set < QUERY_LATENCY; ++set) {
+                glDeleteQueries(2 * FRAME_PHASE_COUNT, querySets_[set].queries);
+            }
+        }
+        gpuReady_ = false;
+    }
+
+    void beginFrame() {
+        ++frame_;
+        FrameSample& sample = current();
+        sample.frameMs = 0.0f;
+        std::fill(sample.cpuMs, sample.cpuMs + FRAME_PHASE_COUNT, 0.0f);
+        std::fill(sample.gpuMs, sample.gpuMs + FRAME_PHASE_COUNT, -1.0f);
+        if (gpuReady_) {
+            QuerySet& set = querySets_[frame_ % QUERY_LATENCY];
+            resolve(set);
+            set.frame = frame_;
+            set.issued = 0;
+        }
+        // The new frame's sample was just reset, so only the ones before it count
+        if (frame_ % PERCENTILE_INTERVAL == 0) {
+            updatePercentiles(frame_ - 1);
+        }
+        frameStart_ = Clock::now();
+    }
+
+    void endFrame() { current().frameMs = millisecondsSince(frameStart_); }
+
+    void beginPhase(FramePhase phase) {
+        int index = static_cast<int>(phase);
+        phaseStart_[index] = Clock::now();
+        if (gpuReady_ && framePhaseUsesGpu(phase)) {
+            QuerySet& set = querySets_[frame_ % QUERY_LATENCY];
+            glQueryCounter(set.queries[2 * index], GL_TIMESTAMP);
+        }
+    }
+
+    // A phase entered more than once in a frame accumulates CPU time; its GPU
+    // time spans the last begin/end pair
+    void endPhase(FramePhase phase) {
+        int index = static_cast<int>(phase);
+        current().cpuMs[index] += millisecondsSince(phaseStart_[index]);
+        if (gpuReady_ && framePhaseUsesGpu(phase)) {
+            QuerySet& set = querySets_[frame_ % QUERY_LATENCY];
+            glQueryCounter(set.queries[2 * index + 1], GL_TIMESTAMP);
+            set.issued |= 1u << index;
+        }
+    }
+
+    const Percentiles& percentiles() const { return percentiles_; }
+
+    // True right after the frame in which the percentiles were recomputed
+    bool percentilesUpdated() const { return frame_ % PERCENTILE_INTERVAL == 0; }
+
+    // Per-phase mean CPU and GPU milliseconds over the history, plus frame-time percentiles
+    void printSummary(std::ostream& out) {
+        int frames = static_cast<int>(std::min<unsigned long long>(frame_, HISTORY_FRAMES));
+        if (frames == 0) {
+            return;
+        }
+        updatePercentiles(frame_);
+        out << "Frame profile over the last " << frames << " frames (ms):\n" << std::fixed << std::setprecision(3);
+        for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+            double cpu = 0.0, gpu = 0.0;
+            int gpuFrames = 0;
+            for (int age = 0; age < frames; ++age) {
+                const FrameSample& sample = history_[(frame_ - age) % HISTORY_FRAMES];
+                cpu += sample.cpuMs[phase];
+                if (sample.gpuMs[phase] >= 0.0f) {
+                    gpu += sample.gpuMs[phase];
+                    ++gpuFrames;
+                }
+            }
+            if (cpu == 0.0 && gpuFrames == 0) {
+                continue; // phase never ran, e.g. drawing in a headless run
+            }
+            out << "  " << std::setw(12) << std::left << framePhaseName(static_cast<FramePhase>(phase)) << std::right
+                << " cpu " << std::setw(8) << cpu / frames;
+            if (gpuFrames > 0) {
+                out << "  gpu " << std::setw(8) << gpu / gpuFrames;
+            }
+            out << "\n";
+        }
+        out << "  frame p50 " << percentiles_.p50 << "  p95 " << percentiles_.p95 << "  p99 " << percentiles_.p99
+            << std::defaultfloat << std::endl;
+    }
+
+    // Stacked per-phase CPU graph, one column per frame, in the top-right corner.
+    // Uses the fixed-function pipeline with the window's orthographic projection.
+    // The dark band ends at 33.3 ms; the lines mark the 16.7 ms budget (green),
+    // p50 (yellow), p95 (orange), p99 (red), and GPU time per frame (white).
+    void drawOverlay(glm::vec2 viewportSize) const {
+        const float pixelsPerMs = 3.0f;
+        const float height = 33.3f * pixelsPerMs;
+        const float left = viewportSize.x - HISTORY_FRAMES - 10.0f;
+        const float bottom = viewportSize.y - height - 10.0f;
+        int frames = static_cast<int>(std::min<unsigned long long>(frame_, HISTORY_FRAMES));
+
+        glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+        glBegin(GL_QUADS);
+        glVertex2f(left, bottom);
+        glVertex2f(left + HISTORY_FRAMES, bottom);
+        glVertex2f(left + HISTORY_FRAMES, bottom + height);
+        glVertex2f(left, bottom + height);
+
+        // Oldest frame on the left
+        for (int age = frames - 1; age >= 0; --age) {
+            const FrameSample& sample = history_[(frame_ - age) % HISTORY_FRAMES];
+            float x = left + (HISTORY_FRAMES - 1 - age);
+            float y = bottom;
+            for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+                float top = std::min(y + sample.cpuMs[phase] * pixelsPerMs, bottom + height);
+                const float* color = PHASE_COLORS[phase];
+                glColor3f(color[0], color[1], color[2]);
+                glVertex2f(x, y);
+                glVertex2f(x + 1.0f, y);
+                glVertex2f(x + 1.0f, top);
+                glVertex2f(x, top);
+                y = top;
+            }
+        }
+        glEnd();
+
+        auto line = [&](float ms, float r, float g, float b) {
+            float y = bottom + std::min(ms * pixelsPerMs, height);
+            glColor3f(r, g, b);
+            glVertex2f(left, y);
+            glVertex2f(left + HISTORY_FRAMES, y);
+        };
+        glBegin(GL_LINES);
+        line(1000.0f / 60.0f, 0.0f, 1.0f, 0.0f);
+        line(percentiles_.p50, 1.0f, 1.0f, 0.0f);
+        line(percentiles_.p95, 1.0f, 0.5f, 0.0f);
+        line(percentiles_.p99, 1.0f, 0.0f, 0.0f);
+        glEnd();
+
+        glColor3f(1.0f, 1.0f, 1.0f);
+        glBegin(GL_LINE_STRIP);
+        for (int age = frames - 1; age >= 0; --age) {
+            const FrameSample& sample = history_[(frame_ - age) % HISTORY_FRAMES];
+            float gpu = 0.0f;
+            for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+                gpu += std::max(sample.gpuMs[phase], 0.0f);
+            }
+            glVertex2f(left + (HISTORY_FRAMES - 1 - age) + 0.5f, bottom + std::min(gpu * pixelsPerMs, height));
+        }
+        glEnd();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Begin/end timestamp queries for every phase of one in-flight frame
+    struct QuerySet {
+        GLuint queries[2 * FRAME_PHASE_COUNT];
+        unsigned long long frame;
+        unsigned issued; // bit per phase whose end timestamp was recorded
+    };
+
+    static constexpr float PHASE_COLORS[FRAME_PHASE_COUNT][3] = {
+        {0.6f, 0.6f, 0.6f}, // input
+        {0.2f, 0.6f, 1.0f}, // update
+        {0.2f, 0.9f, 0.9f}, // collide
+        {0.1f, 0.3f, 0.8f}, // compact
+        {0.3f, 0.8f, 0.3f}, // background
+        {0.6f, 0.9f, 0.3f}, // cannon
+        {0.9f, 0.2f, 0.2f}, // projectiles
+        {0.9f, 0.6f, 0.9f}, // overlay
+        {0.9f, 0.8f, 0.2f}, // swap
+    };
+
+    FrameSample& current() { return history_[frame_ % HISTORY_FRAMES]; }
+
+    static float millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    // Copies a finished query set into its frame's sample if every timestamp is
+    // available and the frame is still in the history
+    void resolve(QuerySet& set) {
+        if (set.issued == 0 || frame_ - set.frame >= HISTORY_FRAMES) {
+            return;
+        }
+        for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+            if (set.issued & (1u << phase)) {
+                GLint available = 0;
+                glGetQueryObjectiv(set.queries[2 * phase + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) {
+                    return;
+                }
+            }
+        }
+        FrameSample& sample = history_[set.frame % HISTORY_FRAMES];
+        for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+            if (set.issued & (1u << phase)) {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(set.queries[2 * phase], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(set.queries[2 * phase + 1], GL_QUERY_RESULT, &end);
+                sample.gpuMs[phase] = static_cast<float>(end - begin) / 1e6f;
+            }
+        }
+    }
+
+    // Over the history up to frame `newest`, the last finished one
+    void updatePercentiles(unsigned long long newest) {
+        int frames = static_cast<int>(std::min<unsigned long long>(newest, HISTORY_FRAMES));
+        if (frames == 0) {
+            return;
+        }
+        sorted_.clear();
+        for (int age = 0; age < frames; ++age) {
+            sorted_.push_back(history_[(newest - age) % HISTORY_FRAMES].frameMs);
+        }
+        std::sort(sorted_.begin(), sorted_.end());
+        auto at = [&](float fraction) { return sorted_[static_cast<std::size_t>(fraction * (frames - 1) + 0.5f)]; };
+        percentiles_ = Percentiles{at(0.50f), at(0.95f), at(0.99f)};
+    }
+
+    unsigned long long frame_;
+    std::vector<FrameSample> history_;
+    std::vector<float> sorted_;
+    Clock::time_point frameStart_;
+    Clock::time_point phaseStart_[FRAME_PHASE_COUNT];
+    QuerySet querySets_[QUERY_LATENCY];
+    bool gpuReady_;
+    Percentiles percentiles_;
+};
+
+inline FrameProfiler frameProfiler;
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) FrameProfiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(frameProfiler, phase)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+
+#endif
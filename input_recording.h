@@ -0,0 +1,384 @@
+#pragma once
+
+#include "fire_schedule.h"
+#include "fixed_point.h"
+#include "simulation_state.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// What the simulation reads from the player in one frame, besides the shots fired
+struct InputFrame {
+    double frameSeconds;
+    float angle;
+    float power;
+    bool collisions;
+};
+
+// Frames between keyframes; a seek replays at most this many frames
+const std::uint32_t KEYFRAME_INTERVAL = 600;
+
+// Input recording file (host byte order):
+//   header    "CNRC", u32 version, u32 CANNON_FIXED_POINT, f64 step seconds,
+//             i32 max steps per frame, u32 keyframe interval
+//   frames    one record per frame: a flags byte, then only the fields that
+//             changed since the previous frame (f64 frame time, f32 angle,
+//             f32 power; bit 3 flips collisions). A frame whose inputs are
+//             unchanged is one byte.
+//   salvos    flags byte 0x40, f32 angle, f32 power, u32 shots: consecutive
+//             shots fired with the same aim, before their frame's record
+//   keyframes flags byte 0x80 before every KEYFRAME_INTERVAL-th frame:
+//             u64 frame, the clock, the cannon's angle, power and position,
+//             the projectile columns and the pending lifetime timers
+// A file cut short (say by a crash) replays up to its last complete record.
+namespace recording {
+
+const char MAGIC[4] = {'C', 'N', 'R', 'C'};
+const std::uint32_t VERSION = 2;
+
+enum : std::uint8_t {
+    FRAME_TIME = 1,
+    ANGLE = 2,
+    POWER = 4,
+    COLLISIONS = 8,
+    SALVO = 0x40,
+    KEYFRAME = 0x80
+};
+
+// Both ends diff the first frame against this
+inline InputFrame initialInputs() {
+    return InputFrame{0.0, 0.0f, 0.0f, true};
+}
+
+template <typename T>
+inline void write(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool read(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+inline void writeState(std::ostream& out, const SimulationState& state) {
+    write(out, state.clock.steps());
+    write(out, state.clock.simulatedTime());
+    write(out, state.clock.accumulator());
+    write(out, state.cannonAngle);
+    write(out, state.cannonPower);
+    write(out, state.cannonPosition.x);
+    write(out, state.cannonPosition.y);
+    write(out, static_cast<std::uint8_t>(state.collisions));
+    write(out, static_cast<std::uint32_t>(state.projectiles.size()));
+    state.projectiles.writeColumns(out);
+
+    // Timers of projectiles still stored, by dense index; the rest would fire on nothing
+    std::vector<std::pair<std::uint32_t, unsigned long long>> timers;
+    state.lifetimeTimers.forEach([&](unsigned long long due, ProjectileHandle handle) {
+        std::size_t dense = state.projectiles.find(handle);
+        if (dense != ProjectileStore::npos) {
+            timers.emplace_back(static_cast<std::uint32_t>(dense), due);
+        }
+    });
+    write(out, static_cast<std::uint32_t>(timers.size()));
+    for (const auto& timer : timers) {
+        write(out, timer.first);
+        write(out, timer.second);
+    }
+}
+
+inline bool readState(std::istream& in, const SimulationState& state) {
+    unsigned long long steps;
+    double simulatedTime;
+    double accumulator;
+    std::uint8_t collisions;
+    std::uint32_t count;
+    if (!read(in, steps) || !read(in, simulatedTime) || !read(in, accumulator) || !read(in, state.cannonAngle) ||
+        !read(in, state.cannonPower) || !read(in, state.cannonPosition.x) || !read(in, state.cannonPosition.y) ||
+        !read(in, collisions) || !read(in, count) ||
+        !state.projectiles.readColumns(in, count)) {
+        return false;
+    }
+    state.clock.restore(steps, simulatedTime, accumulator);
+    state.collisions = collisions != 0;
+
+    std::uint32_t timerCount;
+    if (!read(in, timerCount)) {
+        return false;
+    }
+    state.lifetimeTimers.reset(steps);
+    for (std::uint32_t i = 0; i < timerCount; ++i) {
+        std::uint32_t dense;
+        unsigned long long due;
+        if (!read(in, dense) || !read(in, due) || dense >= count) {
+            return false;
+        }
+        state.lifetimeTimers.schedule(due, state.projectiles.handleAt(dense));
+    }
+    return true;
+}
+
+} // namespace recording
+
+// Writes an input recording as the simulation runs: beginFrame at the top of
+// every frame (it adds the keyframes), recordShot for every shot fired and
+// recordFrame once the frame's inputs are known
+class InputRecorder {
+public:
+    InputRecorder() : frame_(0), last_(recording::initialInputs()), salvo_{0, 0.0f, 0.0f, 0} {}
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    bool recording() const { return file_.is_open(); }
+    unsigned long long frames() const { return frame_; }
+
+    bool open(const std::string& path, const SimulationClock& clock) {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) {
+            std::cerr << "Failed to open input recording " << path << std::endl;
+            return false;
+        }
+        file_.write(recording::MAGIC, sizeof(recording::MAGIC));
+        recording::write(file_, recording::VERSION);
+        recording::write(file_, static_cast<std::uint32_t>(CANNON_FIXED_POINT));
+        recording::write(file_, clock.stepSeconds());
+        recording::write(file_, static_cast<std::int32_t>(clock.maxStepsPerFrame()));
+        recording::write(file_, KEYFRAME_INTERVAL);
+        frame_ = 0;
+        last_ = recording::initialInputs();
+        salvo_.count = 0;
+        return true;
+    }
+
+    void beginFrame(const SimulationState& state) {
+        if (!recording() || frame_ % KEYFRAME_INTERVAL != 0) {
+            return;
+        }
+        recording::write(file_, recording::KEYFRAME);
+        recording::write(file_, frame_);
+        recording::writeState(file_, state);
+        file_.flush(); // so a crash loses at most one keyframe interval
+    }
+
+    void recordShot(float angle, float power) {
+        if (!recording()) {
+            return;
+        }
+        if (salvo_.count > 0 && (angle != salvo_.angle || power != salvo_.power)) {
+            writeSalvo();
+        }
+        salvo_.angle = angle;
+        salvo_.power = power;
+        ++salvo_.count;
+    }
+
+    void recordFrame(const InputFrame& input) {
+        if (!recording()) {
+            return;
+        }
+        if (salvo_.count > 0) {
+            writeSalvo();
+        }
+        std::uint8_t flags = 0;
+        if (std::memcmp(&input.frameSeconds, &last_.frameSeconds, sizeof(double)) != 0) {
+            flags |= recording::FRAME_TIME;
+        }
+        if (input.angle != last_.angle) {
+            flags |= recording::ANGLE;
+        }
+        if (input.power != last_.power) {
+            flags |= recording::POWER;
+        }
+        if (input.collisions != last_.collisions) {
+            flags |= recording::COLLISIONS;
+        }
+        recording::write(file_, flags);
+        if (flags & recording::FRAME_TIME) {
+            recording::write(file_, input.frameSeconds);
+        }
+        if (flags & recording::ANGLE) {
+            recording::write(file_, input.angle);
+        }
+        if (flags & recording::POWER) {
+            recording::write(file_, input.power);
+        }
+        last_ = input;
+        ++frame_;
+    }
+
+    void close() {
+        if (recording()) {
+            file_.close();
+        }
+    }
+
+private:
+    void writeSalvo() {
+        recording::write(file_, recording::SALVO);
+        recording::write(file_, salvo_.angle);
+        recording::write(file_, salvo_.power);
+        recording::write(file_, static_cast<std::uint32_t>(salvo_.count));
+        salvo_.count = 0;
+    }
+
+    std::ofstream file_;
+    unsigned long long frame_;
+    InputFrame last_;
+    FireEvent salvo_; // shots so far this frame with the latest aim
+};
+
+// A loaded input recording: every frame's inputs and salvos decoded up front,
+// keyframes left in the file image until a seek needs one
+class InputReplay {
+public:
+    InputReplay() {}
+
+    InputReplay(const InputReplay&) = delete;
+    InputReplay& operator=(const InputReplay&) = delete;
+
+    bool loaded() const { return !frames_.empty(); }
+    std::size_t size() const { return frames_.size(); }
+    const InputFrame& operator[](std::size_t frame) const { return frames_[frame]; }
+    // The recorded shots as a schedule over replay frames
+    FireSchedule& salvos() { return salvos_; }
+    std::size_t keyframes() const { return keyframes_.size(); }
+
+    // Fails if the file is not a recording or was made with a different
+    // simulation rate or number format, since it would not replay the same
+    bool load(const std::string& path, const SimulationClock& clock) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open input recording " << path << std::endl;
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        image_ = contents.str();
+        frames_.clear();
+        keyframes_.clear();
+        salvos_ = FireSchedule();
+
+        std::istringstream in(image_);
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t fixedPoint;
+        double stepSeconds;
+        std::int32_t maxStepsPerFrame;
+        std::uint32_t keyframeInterval;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, recording::MAGIC, sizeof(magic)) != 0 ||
+            !recording::read(in, version) || version != recording::VERSION || !recording::read(in, fixedPoint) ||
+            !recording::read(in, stepSeconds) || !recording::read(in, maxStepsPerFrame) ||
+            !recording::read(in, keyframeInterval)) {
+            std::cerr << "Failed to read input recording " << path << ": not a version "
+                      << recording::VERSION << " recording" << std::endl;
+            return false;
+        }
+        if (fixedPoint != static_cast<std::uint32_t>(CANNON_FIXED_POINT) || stepSeconds != clock.stepSeconds() ||
+            maxStepsPerFrame != clock.maxStepsPerFrame()) {
+            std::cerr << "Failed to replay " << path << ": recorded with a different simulation rate or "
+                      << "CANNON_FIXED_POINT" << std::endl;
+            return false;
+        }
+
+        InputFrame current = recording::initialInputs();
+        std::uint8_t flags;
+        while (recording::read(in, flags)) {
+            if (flags == recording::KEYFRAME) {
+                unsigned long long frame;
+                std::streamoff offset = in.tellg();
+                if (!recording::read(in, frame) || !skipState(in)) {
+                    break;
+                }
+                keyframes_.push_back(Keyframe{frame, offset});
+                continue;
+            }
+            if (flags == recording::SALVO) {
+                FireEvent salvo{frames_.size(), 0.0f, 0.0f, 0};
+                std::uint32_t count;
+                if (!recording::read(in, salvo.angle) || !recording::read(in, salvo.power) ||
+                    !recording::read(in, count)) {
+                    break;
+                }
+                salvo.count = static_cast<int>(count);
+                salvos_.add(salvo);
+                continue;
+            }
+            if ((flags & recording::FRAME_TIME) && !recording::read(in, current.frameSeconds)) {
+                break;
+            }
+            if ((flags & recording::ANGLE) && !recording::read(in, current.angle)) {
+                break;
+            }
+            if ((flags & recording::POWER) && !recording::read(in, current.power)) {
+                break;
+            }
+            if (flags & recording::COLLISIONS) {
+                current.collisions = !current.collisions;
+            }
+            frames_.push_back(current);
+        }
+        // A keyframe for a frame that never got recorded is no use
+        while (!keyframes_.empty() && keyframes_.back().frame >= frames_.size()) {
+            keyframes_.pop_back();
+        }
+        if (keyframes_.empty() || keyframes_.front().frame != 0) {
+            std::cerr << "Failed to read input recording " << path << ": no keyframes" << std::endl;
+            frames_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Restores the last keyframe at or before `frame` and returns its frame;
+    // replaying the frames from there to `frame` lands exactly where the
+    // recording was. Returns `frame` unchanged if the keyframe is unreadable.
+    unsigned long long seek(unsigned long long frame, const SimulationState& state) const {
+        std::size_t k = keyframes_.size();
+        while (k > 1 && keyframes_[k - 1].frame > frame) {
+            --k;
+        }
+        const Keyframe& keyframe = keyframes_[k - 1];
+        std::istringstream in(image_);
+        in.seekg(keyframe.offset + static_cast<std::streamoff>(sizeof(unsigned long long)));
+        if (!recording::readState(in, state)) {
+            std::cerr << "Failed to restore keyframe at frame " << keyframe.frame << std::endl;
+            return frame;
+        }
+        return keyframe.frame;
+    }
+
+private:
+    struct Keyframe {
+        unsigned long long frame;
+        std::streamoff offset;
+    };
+
+    // Steps over a keyframe's state without decoding the columns
+    static bool skipState(std::istream& in) {
+        const std::streamoff clockAndCannon = sizeof(unsigned long long) + 2 * sizeof(double) + 4 * sizeof(float) + 1;
+        std::uint32_t count;
+        in.seekg(clockAndCannon, std::ios::cur);
+        if (!recording::read(in, count)) {
+            return false;
+        }
+        in.seekg(static_cast<std::streamoff>(count * ProjectileStore().bytesPerProjectile()), std::ios::cur);
+        std::uint32_t timerCount;
+        if (!recording::read(in, timerCount)) {
+            return false;
+        }
+        in.seekg(static_cast<std::streamoff>(timerCount) * (sizeof(std::uint32_t) + sizeof(unsigned long long)),
+                 std::ios::cur);
+        return static_cast<bool>(in);
+    }
+
+    std::string image_;
+    std::vector<InputFrame> frames_;
+    std::vector<Keyframe> keyframes_;
+    FireSchedule salvos_;
+};
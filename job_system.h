@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "trace.h"
+
+// Work-stealing job system for data-parallel per-frame passes.
+//
+// parallelFor splits [begin, end) in halves until a piece is at most `grain`
+// elements; each thread keeps the halves it splits off in its own deque, works
+// LIFO from the back and, when empty, steals FIFO from the front of another
+// thread's deque. The calling thread takes part as worker 0.
+//
+// The split tree depends only on (begin, end, grain), never on thread count or
+// timing, so any body that writes only inside its range - including per-chunk
+// partial results stored by chunk begin - gives identical results for any number
+// of threads. parallelFor calls must not be nested.
+class JobSystem {
+public:
+    // Split points are rounded to this many elements so chunks of float columns
+    // start on cache-line and vector boundaries
+    static const std::size_t SPLIT_ALIGNMENT = 64;
+
+    explicit JobSystem(unsigned threadCount = std::thread::hardware_concurrency())
+        : workers_(std::max(1u, threadCount)), stop_(false), generation_(0), remaining_(0),
+          grain_(1), invoke_(nullptr), context_(nullptr) {
+        for (auto& worker : workers_) {
+            worker.reset(new Worker());
+        }
+        for (unsigned i = 1; i < workers_.size(); ++i) {
+            threads_.emplace_back([this, i] { workerMain(i); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads taking part in a parallelFor, including the caller
+    unsigned threadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+    // Calls body(chunkBegin, chunkEnd) over disjoint chunks covering [begin, end)
+    // and returns once every chunk has finished
+    template <typename Body>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body&& body) {
+        if (end <= begin) {
+            return;
+        }
+        grain = std::max<std::size_t>(grain, 1);
+        if (workers_.size() == 1 || end - begin <= grain) {
+            runSerially(begin, end, grain, body);
+            return;
+        }
+
+        typedef typename std::remove_reference<Body>::type BodyType;
+        grain_ = grain;
+        context_ = const_cast<void*>(static_cast<const void*>(&body));
+        invoke_ = [](void* context, std::size_t chunkBegin, std::size_t chunkEnd) {
+            (*static_cast<BodyType*>(context))(chunkBegin, chunkEnd);
+        };
+        remaining_.store(end - begin, std::memory_order_release);
+        push(0, Range{begin, end});
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        workUntilDone(0);
+    }
+
+private:
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    // Same split tree as the parallel path, so results match it exactly
+    template <typename Body>
+    static void runSerially(std::size_t begin, std::size_t end, std::size_t grain, Body& body) {
+        if (end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+        std::size_t mid = splitPoint(begin, end);
+        runSerially(begin, mid, grain, body);
+        runSerially(mid, end, grain, body);
+    }
+
+    static std::size_t splitPoint(std::size_t begin, std::size_t end) {
+        std::size_t half = (end - begin) / 2;
+        if (half >= SPLIT_ALIGNMENT) {
+            half = (half + SPLIT_ALIGNMENT - 1) / SPLIT_ALIGNMENT * SPLIT_ALIGNMENT;
+        }
+        return begin + std::max<std::size_t>(half, 1);
+    }
+
+    void push(unsigned self, Range range) {
+        Worker& worker = *workers_[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.ranges.push_back(range);
+    }
+
+    bool popOwn(unsigned self, Range& range) {
+        Worker& worker = *workers_[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.ranges.empty()) {
+            return false;
+        }
+        range = worker.ranges.back();
+        worker.ranges.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned self, Range& range) {
+        unsigned count = threadCount();
+        for (unsigned offset = 1; offset < count; ++offset) {
+            Worker& victim = *workers_[(self + offset) % count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(unsigned self, Range range) {
+        std::size_t grain = grain_;
+        while (range.end - range.begin > grain) {
+            std::size_t mid = splitPoint(range.begin, range.end);
+            push(self, Range{mid, range.end});
+            range.end = mid;
+        }
+        {
+            TRACE_SCOPE("job");
+            invoke_(context_, range.begin, range.end);
+        }
+        remaining_.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+    }
+
+    void workUntilDone(unsigned self) {
+        Range range;
+        while (remaining_.load(std::memory_order_acquire) != 0) {
+            if (popOwn(self, range) || steal(self, range)) {
+                run(self, range);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void workerMain(unsigned self) {
+        Tracer::instance().setThreadName("worker " + std::to_string(self));
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            workUntilDone(self);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    unsigned long long generation_;
+
+    // Current parallelFor; set before its first range is pushed
+    std::atomic<std::size_t> remaining_;
+    std::size_t grain_;
+    void (*invoke_)(void* context, std::size_t begin, std::size_t end);
+    void* context_;
+};
@@ -3,80 +3,210 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "projectile.h"
+#include "projectile_store.h"
+#include "projectile_simd.h"
+#include "simulation_clock.h"
+#include "job_system.h"
+#include "circle_renderer.h"
+#include "static_layer.h"
+#include "collision_grid.h"
+#include "collision_simd.h"
+#include "ballistic_engine.h"
+#include "timing_wheel.h"
+#include "fire_schedule.h"
+#include "input_recording.h"
+#include "world_snapshot.h"
+#include "rewind_buffer.h"
+#include "trajectory_export.h"
+#include "firing_solution.h"
+#include "firing_table.h"
+#include "dispersion.h"
+#include "frame_profiler.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <cmath>
 #include <algorithm>
 
-// Constants
-const int WINDOW_WIDTH = 800;
-const int WINDOW_HEIGHT = 600;
-const float GRAVITY = 9.81f;
-const float PI = 3.14159265359f;
-
 // Cannon properties
 float cannonAngle = 45.0f; // Initial angle in degrees
 float cannonPower = 50.0f; // Initial power
 glm::vec2 cannonPosition(50.0f, 50.0f);
 
-// Projectile class
-class Projectile {
-public:
-    glm::vec2 position;
-    glm::vec2 velocity;
-    float radius;
-    bool active;
-    float timeAlive;
-
-    Projectile(glm::vec2 pos, glm::vec2 vel, float r)
-        : position(pos), velocity(vel), radius(r), active(true), timeAlive(0.0f) {}
-
-    void update(float deltaTime) {
-        // Apply gravity
-        velocity.y -= GRAVITY * deltaTime;
-        
-        // Update position
-        position += velocity * deltaTime;
-        
-        // Increase time alive
-        timeAlive += deltaTime;
-        
-        // Check if projectile hits the ground
-        if (position.y <= radius) {
-            position.y = radius;
-            velocity *= 0.5f; // Dampen velocity (bounce)
-            
-            // If velocity is very low, make the projectile inactive
-            if (glm::length(velocity) < 1.0f) {
-                active = false;
-            } else {
-                velocity.y = -velocity.y * 0.7f; // Bounce with energy loss
-            }
-        }
-        
-        // Check if projectile hits the wall
-        if (position.x >= WINDOW_WIDTH - radius) {
-            position.x = WINDOW_WIDTH - radius;
-            velocity.x *= -0.7f; // Bounce off wall
-        }
-    }
-};
+// Simulation rate (fixed steps per second) and the most steps one frame may run.
+// Ground and wall bounces are swept, so the rate only has to resolve shell-shell contacts.
+const double SIMULATION_RATE = 60.0;
+const int MAX_STEPS_PER_FRAME = 8;
+
+// Projectiles per parallel update chunk; small enough to balance, big enough to amortize a steal
+const std::size_t UPDATE_GRAIN = 16384;
+
+// Shell-shell collisions pause while more shells than this are in flight: past
+// it one collision step no longer fits in a frame (cannon_bench --filter collide)
+const std::size_t COLLISION_SHELL_LIMIT = 50000;
 
 // Global variables
-std::vector<Projectile> projectiles;
+ProjectileStore projectiles;
+ProjectileUpdateKernel updateProjectiles = updateProjectilesScalar;
+JobSystem jobs;
+ProjectileCollisions collisions;
+// Removes each shell PROJECTILE_LIFETIME after it is fired; ticks are simulation steps.
+// LIFETIME_STEPS matches the old check of timeAlive > PROJECTILE_LIFETIME after every step.
+TimingWheel<ProjectileHandle> lifetimeTimers;
+const unsigned long long LIFETIME_STEPS = stepsToExpire(static_cast<float>(1.0 / SIMULATION_RATE));
+bool projectileCollisions = true; // Toggle shell-shell collisions with C
+// --analytic replaces the stepped simulation with the event-driven engine
+// (no shell-shell collisions); `projectiles` then stays empty
+bool analyticEngine = false;
+BallisticEngine flights;
+#if CANNON_FIXED_POINT
+// -DCANNON_FIXED_POINT=16 or 32 steps shells in fixed point (fixed_point.h), so
+// runs with the same inputs end in the same state on any machine or compiler
+const FixedConstants<SimFixed> fixedConstants;
+#endif
+// How projectiles (and the cannon base) are drawn; I cycles through them for comparison
+enum class ProjectileRenderPath { Immediate, InstancedFan, InstancedSdf };
+InstancedCircleRenderer circleRenderer;
+ProjectileRenderPath projectileRenderPath = ProjectileRenderPath::InstancedSdf;
+StaticLayerCache staticLayer;
+bool cachedBackground = true; // Toggle with B to redraw the background every frame
+glm::vec2 viewportSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+SimulationClock simulationClock(SIMULATION_RATE, MAX_STEPS_PER_FRAME);
 float lastFrameTime = 0.0f;
 bool fireCannon = false;
+#if CANNON_PROFILING
+bool showProfiler = true; // Toggle the frame-time overlay with P
+#endif
+std::string tracePath; // --trace FILE records a trace; T writes what has been recorded so far
+int traceFlushes = 0;
+bool traceFlushRequested = false; // T waits for the end of the frame, when no scope is open
+// --record FILE saves every frame's inputs with periodic keyframes; --replay FILE
+// feeds them back in place of the keyboard (or fire schedule), from --seek FRAME.
+// [ and ] jump a keyframe interval back or forward while replaying.
+std::string recordPath;
+std::string replayPath;
+unsigned long long seekFrame = 0;
+InputRecorder inputRecorder;
+InputReplay inputReplay;
+unsigned long long replayFrame = 0; // next frame of inputReplay to apply
+long long replaySeekFrames = 0; // [ and ] add up here; the main loop seeks before the next frame
+// --load-snapshot FILE starts from a saved world; --save-snapshot FILE saves it
+// at exit, and F5 saves it there (or to world.cnsn) at any time
+std::string loadSnapshotPath;
+std::string saveSnapshotPath;
+// Backspace steps the world back rewindSeconds (--rewind-seconds) through the
+// last few seconds of history. Capturing costs every frame, so history is only
+// kept when --rewind-mb gives it a budget. Off for --analytic runs, recordings
+// and replays.
+double rewindSeconds = 1.0;
+std::size_t rewindMegabytes = 0;
+RewindBuffer rewindHistory;
+// --export-trajectories FILE streams every shell's state after every step to
+// FILE from a background thread (trajectory_export.h)
+std::string trajectoryPath;
+TrajectoryExporter trajectoryExporter;
+// --firing-table FILE maps precomputed shots for the cannon (firing_table.h),
+// rebuilding FILE first if it is missing or was built with other physics; the
+// window then marks where the current aim first lands
+std::string firingTablePath;
+FiringTable firingTable;
+// --dispersion SHOTS flies SHOTS copies of the aim (--angle, --power) under
+// launch noise (--spread, --seed) and prints where they land, then exits;
+// --dispersion-grid FILE also saves the impact density (dispersion.h)
+std::size_t dispersionShots = 0;
+DispersionSetup dispersionSetup;
+std::string dispersionGridPath;
+
+// Options for --headless runs, which simulate without a window or GL context
+struct HeadlessOptions {
+    bool enabled = false;
+    unsigned long long frames = 6000;
+    double frameTime = 1.0 / 60.0;
+    unsigned long long fireInterval = 10;
+    int salvo = 1;
+    std::string schedulePath;
+};
 
 // Function prototypes
+bool parseArguments(int argc, char** argv, HeadlessOptions& headless);
+int runHeadless(const HeadlessOptions& options);
+int runDispersion();
+void setUpUpdateKernel();
+bool setUpRecording();
+bool loadWorld();
+bool saveWorld();
+void setUpRewind();
+void rewindWorld();
+bool setUpExport(bool headless);
+void closeExport();
+bool setUpFiringTable();
+SimulationState simulationState();
+bool replaying();
+double replayInputs();
+void recordInputs(double frameSeconds);
+void seekReplay(unsigned long long frame);
+void fireSalvo(const FireEvent& event);
+void flushTrace(bool atExit);
+int advanceSimulation(double frameSeconds);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
-void drawCannon();
-void drawProjectiles();
+void aimAtCursor(GLFWwindow* window);
+void drawStaticLayer();
+void drawCannonBase();
+void drawCannonBarrel();
+void drawImpactMarker();
+void drawProjectiles(float alpha);
+void drawFlights();
 void drawGround();
-void fireProjectile();
+ProjectileHandle fireProjectile();
 
-int main() {
+int main(int argc, char** argv) {
+    // Parse command line
+    HeadlessOptions headless;
+    if (!parseArguments(argc, argv, headless)) {
+        return -1;
+    }
+    
+    // Pick the widest update kernel this CPU supports
+    setUpUpdateKernel();
+    
+    // Start recording trace events if asked to
+    if (!tracePath.empty()) {
+        Tracer::instance().setThreadName("main");
+        Tracer::instance().setEnabled(true);
+    }
+    
+    // Load the starting world
+    if (!loadWorld()) {
+        return -1;
+    }
+    
+    // Measure shot dispersion from the loaded cannon instead of running the
+    // simulation if asked to
+    if (dispersionShots > 0) {
+        return runDispersion();
+    }
+    
+    // Open the input recording or replay, the trajectory export and the firing table
+    if (!setUpRecording() || !setUpExport(headless.enabled) || !setUpFiringTable()) {
+        return -1;
+    }
+    
+    // Run without GLFW or GLEW if asked to
+    if (headless.enabled) {
+        return runHeadless(headless);
+    }
+    
+    // Keep recent history to rewind through
+    setUpRewind();
+    
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -121,15 +251,63 @@ int main() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
+    // Set up instanced circle rendering
+    if (!circleRenderer.init()) {
+        std::cerr << "Instanced circle rendering unavailable, using immediate mode" << std::endl;
+        projectileRenderPath = ProjectileRenderPath::Immediate;
+    }
+    
+    // Set up the cached background layer
+    if (!staticLayer.init()) {
+        std::cerr << "Background cache unavailable, drawing it every frame" << std::endl;
+        cachedBackground = false;
+    }
+    
+#if CANNON_PROFILING
+    // Set up GPU timers for the frame profiler
+    if (!frameProfiler.initGpu()) {
+        std::cerr << "GL timer queries unavailable, profiling CPU time only" << std::endl;
+    }
+#endif
+    
     // Main loop
     while (!glfwWindowShouldClose(window)) {
+        // Write the trace T asked for, now that the last frame's scopes are closed
+        if (traceFlushRequested) {
+            traceFlushRequested = false;
+            flushTrace(false);
+        }
+        
+        // Jump the replay where [ and ] asked; the frames it replays run here rather than in the key callback
+        if (replaySeekFrames != 0) {
+            long long target = static_cast<long long>(replayFrame) + replaySeekFrames;
+            replaySeekFrames = 0;
+            seekReplay(static_cast<unsigned long long>(std::max(target, 0LL)));
+        }
+        
+#if CANNON_PROFILING
+        frameProfiler.beginFrame();
+#endif
+        TRACE_SCOPE("frame");
+        
         // Calculate delta time
         float currentTime = glfwGetTime();
         float deltaTime = currentTime - lastFrameTime;
         lastFrameTime = currentTime;
+        double frameSeconds = deltaTime;
+        inputRecorder.beginFrame(simulationState());
+        rewindHistory.capture(simulationState(), jobs);
         
-        // Process input
-        processInput(window);
+        // Process input, or take it from the replay while it lasts
+        {
+            PROFILE_SCOPE(FramePhase::Input);
+            TRACE_SCOPE("input");
+            if (replaying()) {
+                frameSeconds = replayInputs();
+            } else {
+                processInput(window);
+            }
+        }
         
         // Fire cannon if requested
         if (fireCannon) {
@@ -137,51 +315,552 @@ int main() {
             fireCannon = false;
         }
         
-        // Update projectiles
-        for (auto& projectile : projectiles) {
-            if (projectile.active) {
-                projectile.update(deltaTime);
+        // Update projectiles and remove inactive ones
+        recordInputs(frameSeconds);
+        advanceSimulation(frameSeconds);
+        
+        // Draw the background (clear, ground, cannon base) from the cache when possible
+        {
+            PROFILE_SCOPE(FramePhase::Background);
+            TRACE_SCOPE("background");
+            if (!cachedBackground ||
+                !staticLayer.draw(static_cast<int>(viewportSize.x), static_cast<int>(viewportSize.y), drawStaticLayer)) {
+                drawStaticLayer();
             }
         }
         
-        // Remove inactive projectiles
-        projectiles.erase(
-            std::remove_if(projectiles.begin(), projectiles.end(),
-                [](const Projectile& p) { return !p.active || p.timeAlive > 10.0f; }),
-            projectiles.end()
-        );
-        
-        // Clear screen
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
-        // Draw ground
-        drawGround();
-        
-        // Draw cannon
-        drawCannon();
+        // Draw cannon barrel
+        {
+            PROFILE_SCOPE(FramePhase::Cannon);
+            TRACE_SCOPE("cannon");
+            drawCannonBarrel();
+            drawImpactMarker();
+        }
         
         // Draw projectiles
-        drawProjectiles();
+        {
+            PROFILE_SCOPE(FramePhase::Projectiles);
+            TRACE_SCOPE("projectiles");
+            CircleStyle style = projectileRenderPath == ProjectileRenderPath::InstancedSdf
+                ? CircleStyle::Sdf : CircleStyle::Fan;
+            if (analyticEngine) {
+                if (projectileRenderPath == ProjectileRenderPath::Immediate) {
+                    drawFlights();
+                } else {
+                    circleRenderer.drawFlights(flights, viewportSize, style, jobs);
+                }
+            } else if (projectileRenderPath == ProjectileRenderPath::Immediate) {
+                drawProjectiles(simulationClock.alpha());
+            } else {
+                circleRenderer.drawProjectiles(projectiles, simulationClock.alpha(), viewportSize, style, jobs);
+            }
+        }
         
         // Display cannon stats
         // (In a real implementation, you would use text rendering here)
         
+#if CANNON_PROFILING
+        // Frame-time graph; the percentiles go in the window title
+        if (showProfiler) {
+            PROFILE_SCOPE(FramePhase::Overlay);
+            TRACE_SCOPE("overlay");
+            frameProfiler.drawOverlay(viewportSize);
+        }
+        if (frameProfiler.percentilesUpdated()) {
+            const FrameProfiler::Percentiles& p = frameProfiler.percentiles();
+            std::string title = "Cannon Simulator - frame p50 " + std::to_string(p.p50) + " ms, p95 " +
+                                std::to_string(p.p95) + " ms, p99 " + std::to_string(p.p99) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+        }
+#endif
+        
         // Swap buffers and poll events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE(FramePhase::Swap);
+            TRACE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        
+#if CANNON_PROFILING
+        frameProfiler.endFrame();
+#endif
     }
     
     // Clean up
+#if CANNON_PROFILING
+    frameProfiler.printSummary(std::cout);
+    frameProfiler.destroyGpu();
+#endif
+    flushTrace(true);
+    inputRecorder.close();
+    closeExport();
+    if (!saveSnapshotPath.empty()) {
+        saveWorld();
+    }
+    circleRenderer.destroy();
+    staticLayer.destroy();
     glfwTerminate();
     return 0;
 }
 
+bool parseArguments(int argc, char** argv, HeadlessOptions& headless) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless.enabled = true;
+            continue;
+        }
+        if (arg == "--no-collisions") {
+            projectileCollisions = false;
+            continue;
+        }
+        if (arg == "--analytic") {
+            analyticEngine = true;
+            continue;
+        }
+        
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (value && arg == "--frames") {
+            headless.frames = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--frame-time") {
+            headless.frameTime = std::atof(value);
+        } else if (value && arg == "--fire-every") {
+            headless.fireInterval = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--salvo") {
+            headless.salvo = std::atoi(value);
+        } else if (value && arg == "--schedule") {
+            headless.schedulePath = value;
+        } else if (value && arg == "--trace") {
+            tracePath = value;
+        } else if (value && arg == "--record") {
+            recordPath = value;
+        } else if (value && arg == "--replay") {
+            replayPath = value;
+        } else if (value && arg == "--seek") {
+            seekFrame = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--load-snapshot") {
+            loadSnapshotPath = value;
+        } else if (value && arg == "--save-snapshot") {
+            saveSnapshotPath = value;
+        } else if (value && arg == "--rewind-mb") {
+            rewindMegabytes = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--rewind-seconds") {
+            rewindSeconds = std::max(std::atof(value), 0.0);
+        } else if (value && arg == "--export-trajectories") {
+            trajectoryPath = value;
+        } else if (value && arg == "--firing-table") {
+            firingTablePath = value;
+        } else if (value && arg == "--angle") {
+            cannonAngle = std::min(std::max(static_cast<float>(std::atof(value)), MIN_CANNON_ANGLE), MAX_CANNON_ANGLE);
+        } else if (value && arg == "--power") {
+            cannonPower = std::min(std::max(static_cast<float>(std::atof(value)), MIN_CANNON_POWER), MAX_CANNON_POWER);
+        } else if (value && arg == "--dispersion") {
+            dispersionShots = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--spread") {
+            if (std::sscanf(value, "%f,%f,%f", &dispersionSetup.angleSigma, &dispersionSetup.powerSigma,
+                            &dispersionSetup.positionSigma) != 3) {
+                std::cerr << "Failed to parse --spread " << value << ", expected ANGLE,POWER,POSITION" << std::endl;
+                return false;
+            }
+        } else if (value && arg == "--hit-radius") {
+            dispersionSetup.hitRadius = static_cast<float>(std::atof(value));
+        } else if (value && arg == "--seed") {
+            dispersionSetup.seed = std::strtoull(value, NULL, 10);
+        } else if (value && arg == "--dispersion-grid") {
+            dispersionGridPath = value;
+        } else {
+            std::cerr << "Unknown or incomplete option " << arg << "\n"
+                      << "Usage: cannon_simulator [--trace FILE] [--no-collisions] [--analytic]\n"
+                      << "                         [--record FILE | --replay FILE [--seek FRAME]]\n"
+                      << "                         [--load-snapshot FILE] [--save-snapshot FILE]\n"
+                      << "                         [--rewind-mb MB [--rewind-seconds SECONDS]]\n"
+                      << "                         [--export-trajectories FILE] [--firing-table FILE]\n"
+                      << "                         [--angle DEGREES] [--power POWER]\n"
+                      << "                         [--dispersion SHOTS [--spread ANGLE,POWER,POSITION]\n"
+                      << "                         [--hit-radius PIXELS] [--seed N] [--dispersion-grid FILE]]\n"
+                      << "                         [--headless [--frames N] [--frame-time SECONDS]\n"
+                      << "                         [--fire-every FRAMES] [--salvo SHOTS] [--schedule FILE]]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void setUpUpdateKernel() {
+    SimdLevel simdLevel = detectSimdLevel();
+    updateProjectiles = selectUpdateKernel(simdLevel);
+    std::cout << "Projectile update kernel: " << simdLevelName(simdLevel) << std::endl;
+#ifndef NDEBUG
+    if (!(compareUpdateKernelWithScalar(updateProjectiles) <= SIMD_UPDATE_TOLERANCE)) {
+        std::cerr << "SIMD update kernel disagrees with the scalar path, falling back" << std::endl;
+        updateProjectiles = updateProjectilesScalar;
+    }
+#endif
+
+    NarrowphaseKernel narrowphase = selectNarrowphaseKernel(simdLevel);
+#ifndef NDEBUG
+    if (compareNarrowphaseWithScalar(narrowphase) != 0.0f) {
+        std::cerr << "SIMD narrowphase disagrees with the scalar path, falling back" << std::endl;
+        narrowphase = findContacts;
+    }
+#endif
+    collisions.setNarrowphase(narrowphase);
+}
+
+// Opens --record or --replay. Recordings cover the stepped simulation only.
+bool setUpRecording() {
+    if (recordPath.empty() && replayPath.empty()) {
+        return true;
+    }
+    if (!recordPath.empty() && !replayPath.empty()) {
+        std::cerr << "Failed to start: --record and --replay cannot be combined" << std::endl;
+        return false;
+    }
+    if (analyticEngine) {
+        std::cerr << "Failed to start: --analytic runs cannot be recorded or replayed" << std::endl;
+        return false;
+    }
+    if (!recordPath.empty()) {
+        return inputRecorder.open(recordPath, simulationClock);
+    }
+    if (!inputReplay.load(replayPath, simulationClock)) {
+        return false;
+    }
+    std::cout << "Replaying " << inputReplay.size() << " frames, " << inputReplay.keyframes() << " keyframes"
+              << std::endl;
+    seekReplay(seekFrame);
+    return true;
+}
+
+// Restores --load-snapshot, if given. Snapshots hold the stepped simulation only.
+bool loadWorld() {
+    if (loadSnapshotPath.empty()) {
+        return true;
+    }
+    if (analyticEngine || !replayPath.empty()) {
+        std::cerr << "Failed to start: --load-snapshot cannot be combined with --analytic or --replay" << std::endl;
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    MappedSnapshot snapshot;
+    if (!snapshot.open(loadSnapshotPath) || !snapshot.restore(simulationState())) {
+        return false;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << projectiles.size() << " projectiles from " << loadSnapshotPath << " in "
+              << milliseconds << " ms" << std::endl;
+    return true;
+}
+
+bool saveWorld() {
+    if (analyticEngine) {
+        std::cerr << "Failed to save snapshot: --analytic runs have no stepped world" << std::endl;
+        return false;
+    }
+    std::string path = saveSnapshotPath.empty() ? "world.cnsn" : saveSnapshotPath;
+    if (!saveSnapshot(path, simulationState())) {
+        return false;
+    }
+    std::cout << "Saved " << projectiles.size() << " projectiles to " << path << std::endl;
+    return true;
+}
+
+void setUpRewind() {
+    if (analyticEngine || !recordPath.empty() || !replayPath.empty()) {
+        return;
+    }
+    rewindHistory.setBudget(rewindMegabytes << 20);
+}
+
+void rewindWorld() {
+    if (!rewindHistory.enabled()) {
+        std::cout << "No history to rewind through (start with --rewind-mb MB to keep some)" << std::endl;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!rewindHistory.rewindTo(simulationClock.simulatedTime() - rewindSeconds, simulationState(), jobs)) {
+        return;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Rewound to " << simulationClock.simulatedTime() << " s (" << projectiles.size()
+              << " projectiles) in " << milliseconds << " ms" << std::endl;
+}
+
+// Opens --export-trajectories, if given. Only the stepped simulation has steps
+// to sample. Headless runs have no frame deadline, so they wait for the writer
+// instead of dropping samples.
+bool setUpExport(bool headless) {
+    if (trajectoryPath.empty()) {
+        return true;
+    }
+    if (analyticEngine) {
+        std::cerr << "Failed to start: --analytic runs have no steps to export" << std::endl;
+        return false;
+    }
+    return trajectoryExporter.open(trajectoryPath, simulationClock.stepSeconds(), headless);
+}
+
+// Maps --firing-table, building it first if it is missing or stale
+bool setUpFiringTable() {
+    if (firingTablePath.empty()) {
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!firingTable.load(firingTablePath, jobs, cannonPosition, simulationClock.stepSeconds())) {
+        std::cerr << "Failed to load firing table " << firingTablePath << std::endl;
+        return false;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (firingTable.rebuilt() ? "Built firing table " : "Mapped firing table ") << firingTablePath
+              << " (" << firingTable.shots() << " shots) in " << milliseconds << " ms" << std::endl;
+    return true;
+}
+
+void closeExport() {
+    if (!trajectoryExporter.isOpen()) {
+        return;
+    }
+    unsigned long long samples = trajectoryExporter.samples();
+    unsigned long long dropped = trajectoryExporter.droppedSamples();
+    if (trajectoryExporter.close()) {
+        std::cout << "Exported " << samples << " trajectory samples to " << trajectoryPath << " ("
+                  << trajectoryExporter.bytesWritten() / 1e6 << " MB)";
+        if (dropped > 0) {
+            std::cout << ", dropped " << dropped << " while the writer was behind";
+        }
+        std::cout << std::endl;
+    }
+}
+
+SimulationState simulationState() {
+    return SimulationState{projectiles, lifetimeTimers, simulationClock, cannonAngle, cannonPower,
+                           cannonPosition, projectileCollisions};
+}
+
+bool replaying() {
+    return replayFrame < inputReplay.size();
+}
+
+// Applies the next recorded frame's shots and inputs; returns its frame time
+double replayInputs() {
+    inputReplay.salvos().fireDue(replayFrame, fireSalvo);
+    const InputFrame& input = inputReplay[replayFrame++];
+    cannonAngle = input.angle;
+    cannonPower = input.power;
+    projectileCollisions = input.collisions;
+    return input.frameSeconds;
+}
+
+void recordInputs(double frameSeconds) {
+    inputRecorder.recordFrame(InputFrame{frameSeconds, cannonAngle, cannonPower, projectileCollisions});
+}
+
+// Restores the last keyframe at or before `frame`, then runs the recorded
+// frames from there without drawing
+void seekReplay(unsigned long long frame) {
+    if (!inputReplay.loaded()) {
+        return;
+    }
+    TRACE_SCOPE("seek");
+    frame = std::min<unsigned long long>(frame, inputReplay.size());
+    replayFrame = inputReplay.seek(frame, simulationState());
+    inputReplay.salvos().seek(replayFrame);
+    while (replayFrame < frame) {
+        advanceSimulation(replayInputs());
+    }
+}
+
+// Aims and fires one scheduled or replayed salvo, within the limits processInput enforces
+void fireSalvo(const FireEvent& event) {
+    cannonAngle = std::min(std::max(event.angle, MIN_CANNON_ANGLE), MAX_CANNON_ANGLE);
+    cannonPower = std::min(std::max(event.power, MIN_CANNON_POWER), MAX_CANNON_POWER);
+    for (int shot = 0; shot < event.count; ++shot) {
+        fireProjectile();
+    }
+}
+
+// Writes the trace events recorded since the last flush: to the --trace path at
+// exit, to numbered files next to it when asked for during the run
+void flushTrace(bool atExit) {
+    if (tracePath.empty()) {
+        return;
+    }
+    std::string path = atExit ? tracePath : tracePath + "." + std::to_string(++traceFlushes);
+    if (Tracer::instance().flush(path)) {
+        std::cout << "Wrote trace " << path << std::endl;
+    }
+}
+
+// Runs the fixed steps owed for frameSeconds of elapsed time, keeping the last
+// state for interpolation, then drops dead projectiles. Returns the step count.
+// The event-driven engine has no steps: it applies the impacts and expiries due
+// by the end of the frame and returns 0.
+int advanceSimulation(double frameSeconds) {
+    if (analyticEngine) {
+        PROFILE_SCOPE(FramePhase::Update);
+        TRACE_SCOPE("events");
+        flights.advanceTo(flights.now() + std::max(frameSeconds, 0.0));
+        return 0;
+    }
+    
+    int steps = simulationClock.advance(frameSeconds);
+    unsigned long long firstStep = simulationClock.steps() - steps + 1;
+    float stepTime = static_cast<float>(simulationClock.stepSeconds());
+#if CANNON_FIXED_POINT
+    const SimFixed fixedStepTime = SimFixed::fromFloat(stepTime);
+#endif
+    for (int step = 0; step < steps; ++step) {
+        projectiles.savePreviousPositions();
+        ProjectileSpan span = projectiles.span();
+        {
+            PROFILE_SCOPE(FramePhase::Update);
+            TRACE_SCOPE("update");
+#if CANNON_FIXED_POINT
+            FixedProjectileSpan<SimFixed> fixed = projectiles.fixedSpan();
+            jobs.parallelFor(0, span.count, UPDATE_GRAIN, [&](std::size_t begin, std::size_t end) {
+                updateFixedProjectileColumns(span.subspan(begin, end - begin), fixed.subspan(begin, end - begin),
+                                             fixedStepTime, stepTime, fixedConstants);
+            });
+#else
+            jobs.parallelFor(0, span.count, UPDATE_GRAIN, [&](std::size_t begin, std::size_t end) {
+                updateProjectiles(span.subspan(begin, end - begin), stepTime);
+            });
+#endif
+        }
+        
+        // Shell-shell collisions (float physics, so not in fixed-point builds)
+        if (projectileCollisions && !CANNON_FIXED_POINT && span.count <= COLLISION_SHELL_LIMIT) {
+            PROFILE_SCOPE(FramePhase::Collide);
+            TRACE_SCOPE("collide");
+            collisions.step(span, jobs);
+        }
+        
+        // Queue this step's states for the trajectory writer
+        if (trajectoryExporter.isOpen()) {
+            TRACE_SCOPE("export");
+            trajectoryExporter.sample(firstStep + step, projectiles);
+        }
+    }
+    
+    // Remove expired and settled projectiles. Shells that settled early leave
+    // their timers behind; those fire on a stale handle and do nothing. Expired
+    // shells are only marked, so the order timers fire in cannot change the
+    // dense order eraseIf leaves (replays restore timers in a different order).
+    PROFILE_SCOPE(FramePhase::Compact);
+    TRACE_SCOPE("compact");
+    lifetimeTimers.advanceTo(simulationClock.steps(), [](ProjectileHandle handle) { projectiles.deactivate(handle); });
+    projectiles.eraseIf([](const ProjectileStore::ConstRef& p) { return !p.active(); });
+    return steps;
+}
+
+// The windowed loop minus input polling and drawing: the fire schedule stands in
+// for the keyboard and every frame advances a fixed frameTime
+int runHeadless(const HeadlessOptions& options) {
+    FireSchedule schedule;
+    if (inputReplay.loaded()) {
+        // The recording supplies frames, frame times and shots
+    } else if (options.schedulePath.empty()) {
+        schedule = FireSchedule::periodic(options.frames, options.fireInterval, options.salvo,
+                                          cannonAngle, cannonPower);
+    } else if (!schedule.load(options.schedulePath)) {
+        return -1;
+    }
+    
+    unsigned long long totalSteps = 0;
+    unsigned long long projectileUpdates = 0;
+    std::size_t peakProjectiles = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    unsigned long long frames = inputReplay.loaded() ? inputReplay.size() - replayFrame : options.frames;
+    for (unsigned long long frame = 0; frame < frames; ++frame) {
+#if CANNON_PROFILING
+        frameProfiler.beginFrame();
+#endif
+        TRACE_SCOPE("frame");
+        inputRecorder.beginFrame(simulationState());
+        // Fire whatever the schedule (or recording) has due
+        double frameSeconds = options.frameTime;
+        if (replaying()) {
+            frameSeconds = replayInputs();
+        } else {
+            schedule.fireDue(frame, fireSalvo);
+        }
+        recordInputs(frameSeconds);
+        
+        std::size_t live = analyticEngine ? flights.size() : projectiles.size();
+        peakProjectiles = std::max(peakProjectiles, live);
+        int steps = advanceSimulation(frameSeconds);
+        totalSteps += steps;
+        projectileUpdates += static_cast<unsigned long long>(steps) * live;
+#if CANNON_PROFILING
+        frameProfiler.endFrame();
+#endif
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Headless run: " << frames << " frames, " << totalSteps << " steps, "
+              << (inputReplay.loaded() ? inputReplay.salvos().size() : schedule.size()) << " fire events in "
+              << seconds << " s\n"
+              << "  simulated steps/s:   " << totalSteps / seconds << "\n"
+              << "  projectile updates/s: " << projectileUpdates / seconds << "\n"
+              << "  peak projectiles:    " << peakProjectiles << "\n"
+              << "  live at end:         " << (analyticEngine ? flights.size() : projectiles.size()) << std::endl;
+    if (analyticEngine) {
+        std::cout << "  events applied:      " << flights.eventsProcessed() << std::endl;
+    }
+    std::cout << "  state hash:          " << std::hex << (analyticEngine ? flights.hash() : projectiles.hash())
+              << std::dec << std::endl;
+#if CANNON_PROFILING
+    frameProfiler.printSummary(std::cout);
+#endif
+    flushTrace(true);
+    inputRecorder.close();
+    closeExport();
+    if (!saveSnapshotPath.empty() && !saveWorld()) {
+        return -1;
+    }
+    return 0;
+}
+
+// Monte Carlo dispersion of the current aim on the job system
+int runDispersion() {
+    dispersionSetup.angle = cannonAngle;
+    dispersionSetup.power = cannonPower;
+    DispersionAnalysis analysis(cannonPosition, simulationClock.stepSeconds());
+    auto start = std::chrono::steady_clock::now();
+    const DispersionResult& result = analysis.run(jobs, dispersionSetup, dispersionShots);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "Dispersion of " << result.shots << " shots at " << dispersionSetup.angle << " degrees, power "
+              << dispersionSetup.power << " (sigma " << dispersionSetup.angleSigma << " degrees, "
+              << dispersionSetup.powerSigma << " power, " << dispersionSetup.positionSigma << " px; seed "
+              << dispersionSetup.seed << ")\n"
+              << "  shots/s:             " << result.shots / seconds << "\n"
+              << "  nominal impact:      " << result.nominal.x << ", " << result.nominal.y
+              << (result.nominal.landed ? "" : " (still in the air)") << "\n"
+              << "  impacts:             " << result.impacts << "\n"
+              << "  mean point of impact: " << result.meanImpact.x << ", " << result.meanImpact.y << "\n"
+              << "  deviation x, y:      " << result.deviation.x << ", " << result.deviation.y << "\n"
+              << "  CEP (50%):           " << result.cep << "\n"
+              << "  R90:                 " << result.r90 << "\n"
+              << "  hit probability:     " << result.hitProbability() << " within " << dispersionSetup.hitRadius
+              << " px of the nominal impact" << std::endl;
+    if (!dispersionGridPath.empty() && !analysis.writeGrid(dispersionGridPath)) {
+        return -1;
+    }
+    flushTrace(true);
+    return 0;
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     glOrtho(0.0, width, 0.0, height, -1.0, 1.0);
+    viewportSize = glm::vec2(width, height);
+    staticLayer.invalidate();
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -189,31 +868,112 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         glfwSetWindowShouldClose(window, true);
     }
     
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+    // While a replay runs the recording owns the simulation's inputs
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS && !replaying()) {
         fireCannon = true;
     }
+    
+    if (key == GLFW_KEY_I && action == GLFW_PRESS && circleRenderer.ready()) {
+        switch (projectileRenderPath) {
+        case ProjectileRenderPath::Immediate: projectileRenderPath = ProjectileRenderPath::InstancedFan; break;
+        case ProjectileRenderPath::InstancedFan: projectileRenderPath = ProjectileRenderPath::InstancedSdf; break;
+        case ProjectileRenderPath::InstancedSdf: projectileRenderPath = ProjectileRenderPath::Immediate; break;
+        }
+        staticLayer.invalidate();
+    }
+    
+    if (key == GLFW_KEY_B && action == GLFW_PRESS && staticLayer.ready()) {
+        cachedBackground = !cachedBackground;
+    }
+    
+    if (key == GLFW_KEY_C && action == GLFW_PRESS && !replaying()) {
+        projectileCollisions = !projectileCollisions;
+    }
+    
+    if (key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS && inputReplay.loaded()) {
+        replaySeekFrames -= KEYFRAME_INTERVAL;
+    }
+    if (key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS && inputReplay.loaded()) {
+        replaySeekFrames += KEYFRAME_INTERVAL;
+    }
+    
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        traceFlushRequested = true;
+    }
+    
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        saveWorld();
+    }
+    
+    if (key == GLFW_KEY_BACKSPACE && action == GLFW_PRESS) {
+        rewindWorld();
+    }
+    
+#if CANNON_PROFILING
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        showProfiler = !showProfiler;
+    }
+#endif
 }
 
 void processInput(GLFWwindow* window) {
     // Adjust cannon angle
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        cannonAngle = std::min(cannonAngle + 1.0f, 90.0f);
+        cannonAngle = std::min(cannonAngle + 1.0f, MAX_CANNON_ANGLE);
     }
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        cannonAngle = std::max(cannonAngle - 1.0f, 0.0f);
+        cannonAngle = std::max(cannonAngle - 1.0f, MIN_CANNON_ANGLE);
     }
     
     // Adjust cannon power
     if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        cannonPower = std::min(cannonPower + 1.0f, 100.0f);
+        cannonPower = std::min(cannonPower + 1.0f, MAX_CANNON_POWER);
     }
     if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        cannonPower = std::max(cannonPower - 1.0f, 10.0f);
+        cannonPower = std::max(cannonPower - 1.0f, MIN_CANNON_POWER);
+    }
+    
+    // Holding the right mouse button keeps the cannon aimed at the cursor
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+        aimAtCursor(window);
     }
 }
 
-void drawCannon() {
+// Aims through the point under the cursor (firing_solution.h); out-of-reach
+// points leave the aim as it was
+void aimAtCursor(GLFWwindow* window) {
+    double cursorX = 0.0;
+    double cursorY = 0.0;
+    int windowWidth = 0;
+    int windowHeight = 0;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        return;
+    }
+    // The projection maps framebuffer pixels, bottom-left origin, to world units
+    glm::vec2 target(cursorX * viewportSize.x / windowWidth, viewportSize.y - cursorY * viewportSize.y / windowHeight);
+    FiringSolution solution = FiringSolver(cannonPosition).solve(target);
+    if (solution.path != FiringPath::Unreachable) {
+        cannonAngle = solution.angle;
+        cannonPower = solution.power;
+    }
+}
+
+// Everything that only changes on resize; rendered into the static layer cache
+void drawStaticLayer() {
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    drawGround();
+    drawCannonBase();
+}
+
+void drawCannonBase() {
     // Base of the cannon (circle)
+    if (projectileRenderPath == ProjectileRenderPath::InstancedSdf) {
+        circleRenderer.drawCircle(cannonPosition, 20.0f, CANNON_BASE_COLOR, viewportSize, CircleStyle::Sdf);
+        return;
+    }
     glColor3f(0.5f, 0.5f, 0.5f);
     glBegin(GL_TRIANGLE_FAN);
     glVertex2f(cannonPosition.x, cannonPosition.y);
@@ -223,7 +983,9 @@ void drawCannon() {
                    cannonPosition.y + 20.0f * sin(radian));
     }
     glEnd();
-    
+}
+
+void drawCannonBarrel() {
     // Barrel of the cannon
     glColor3f(0.3f, 0.3f, 0.3f);
     glPushMatrix();
@@ -240,22 +1002,63 @@ void drawCannon() {
     glPopMatrix();
 }
 
-void drawProjectiles() {
-    for (const auto& projectile : projectiles) {
-        if (projectile.active) {
+void drawImpactMarker() {
+    // Where the current aim first lands, from the firing table; nothing for
+    // an aim still in the air when its lifetime ends
+    if (!firingTable.isOpen()) {
+        return;
+    }
+    FiringTableEntry shot = firingTable.lookup(cannonAngle, cannonPower);
+    if (!shot.landed) {
+        return;
+    }
+    glm::vec2 impact(cannonPosition.x + shot.range, SHELL_RADIUS);
+    if (projectileRenderPath == ProjectileRenderPath::InstancedSdf) {
+        circleRenderer.drawCircle(impact, 4.0f, IMPACT_MARKER_COLOR, viewportSize, CircleStyle::Sdf);
+        return;
+    }
+    glColor3f(0.9f, 0.9f, 0.2f);
+    glBegin(GL_TRIANGLE_FAN);
+    glVertex2f(impact.x, impact.y);
+    for (int i = 0; i <= 360; i += 30) {
+        float radian = i * PI / 180.0f;
+        glVertex2f(impact.x + 4.0f * cos(radian), impact.y + 4.0f * sin(radian));
+    }
+    glEnd();
+}
+
+void drawProjectiles(float alpha) {
+    for (auto projectile : projectiles) {
+        if (projectile.active()) {
+            glm::vec2 position = projectile.interpolatedPosition(alpha);
+            float radius = projectile.radius();
             glColor3f(0.9f, 0.1f, 0.1f);
             glBegin(GL_TRIANGLE_FAN);
-            glVertex2f(projectile.position.x, projectile.position.y);
+            glVertex2f(position.x, position.y);
             for (int i = 0; i <= 360; i += 10) {
                 float radian = i * PI / 180.0f;
-                glVertex2f(projectile.position.x + projectile.radius * cos(radian),
-                           projectile.position.y + projectile.radius * sin(radian));
+                glVertex2f(position.x + radius * cos(radian),
+                           position.y + radius * sin(radian));
             }
             glEnd();
         }
     }
 }
 
+void drawFlights() {
+    glColor3f(0.9f, 0.1f, 0.1f);
+    flights.forEach([](glm::vec2 position, float radius) {
+        glBegin(GL_TRIANGLE_FAN);
+        glVertex2f(position.x, position.y);
+        for (int i = 0; i <= 360; i += 10) {
+            float radian = i * PI / 180.0f;
+            glVertex2f(position.x + radius * cos(radian),
+                       position.y + radius * sin(radian));
+        }
+        glEnd();
+    });
+}
+
 void drawGround() {
     glColor3f(0.0f, 0.7f, 0.0f);
     glBegin(GL_QUADS);
@@ -266,21 +1069,21 @@ void drawGround() {
     glEnd();
 }
 
-void fireProjectile() {
-    // Calculate initial velocity based on angle and power
-    float radianAngle = cannonAngle * PI / 180.0f;
-    glm::vec2 initialVelocity(
-        cannonPower * cos(radianAngle),
-        cannonPower * sin(radianAngle)
-    );
-    
-    // Calculate the barrel end position
-    glm::vec2 barrelEnd(
-        cannonPosition.x + 40.0f * cos(radianAngle),
-        cannonPosition.y + 40.0f * sin(radianAngle)
-    );
-    
-    // Create a new projectile
-    Projectile projectile(barrelEnd, initialVelocity, 5.0f);
-    projectiles.push_back(projectile);
+ProjectileHandle fireProjectile() {
+    // Create a new projectile at the barrel end
+    Projectile projectile = launchProjectile(cannonPosition, cannonAngle, cannonPower);
+    if (analyticEngine) {
+        flights.launch(projectile);
+        return ProjectileHandle();
+    }
+#if CANNON_FIXED_POINT
+    ProjectileHandle handle = projectiles.push(launchFixedProjectile(
+        SimFixed::fromFloat(cannonPosition.x), SimFixed::fromFloat(cannonPosition.y),
+        SimFixed::fromFloat(cannonAngle), SimFixed::fromFloat(cannonPower)));
+#else
+    ProjectileHandle handle = projectiles.push(projectile);
+#endif
+    inputRecorder.recordShot(cannonAngle, cannonPower);
+    lifetimeTimers.schedule(simulationClock.steps() + LIFETIME_STEPS, handle);
+    return handle;
 }
\ No newline at end of file
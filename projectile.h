@@ -0,0 +1,233 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cmath>
+
+// Constants
+const int WINDOW_WIDTH = 800;
+const int WINDOW_HEIGHT = 600;
+const float GRAVITY = 9.81f;
+const float PI = 3.14159265359f;
+
+struct ProjectileSpan;
+
+// Seconds a shell lives before it is removed, settled or not
+const float PROJECTILE_LIFETIME = 10.0f;
+
+// Steps of stepTime until a shell's timeAlive, summed one float step at a time
+// as the update does, first exceeds PROJECTILE_LIFETIME. Rounding makes this one
+// more than ceil(PROJECTILE_LIFETIME / stepTime) at some rates (120 and 240 Hz).
+inline unsigned long long stepsToExpire(float stepTime) {
+    float timeAlive = 0.0f;
+    unsigned long long steps = 0;
+    while (!(timeAlive > PROJECTILE_LIFETIME)) {
+        timeAlive += stepTime;
+        ++steps;
+    }
+    return steps;
+}
+
+// Fraction of its horizontal speed a shell keeps off the right wall
+const float WALL_RESTITUTION = 0.7f;
+
+// Most bounces one step resolves; anything left after that flies on uncollided
+const int MAX_BOUNCES_PER_STEP = 8;
+
+// Exact ballistic flight for t seconds (no contact). The update kernels do
+// these operations in this order, so every path lands on the same floats.
+inline void flyProjectile(float& px, float& py, float vx, float& vy, float t) {
+    px = px + vx * t;
+    py = py + vy * t - 0.5f * GRAVITY * t * t;
+    vy = vy - GRAVITY * t;
+}
+
+// Whether a shell's centre at (px, py) is touching the ground or the wall
+inline bool projectileInContact(float px, float py, float r) {
+    return py <= r || px >= WINDOW_WIDTH - r;
+}
+
+// Seconds until a centre `height` above its resting height, moving up at vy,
+// comes down to it: the later root of height + vy t - g t^2 / 2 = 0, in the
+// form that does not cancel. 0 if it is at or below and not rising, or can
+// never rise to it.
+inline float timeToGround(float height, float vy) {
+    float discriminant = vy * vy + 2.0f * GRAVITY * height;
+    if (discriminant < 0.0f || (height <= 0.0f && vy <= 0.0f)) {
+        return 0.0f;
+    }
+    float root = std::sqrt(discriminant);
+    return vy > 0.0f ? (vy + root) / GRAVITY : 2.0f * height / (root - vy);
+}
+
+// Seconds until a centre at px, moving right at vx, reaches the right wall;
+// 0 if it is already there, INFINITY if it is not moving right
+inline float timeToWall(float px, float vx, float r) {
+    return vx > 0.0f ? std::fmax((WINDOW_WIDTH - r - px) / vx, 0.0f) : INFINITY;
+}
+
+// Bounce at the moment of ground contact. Returns false if the shell settled.
+inline bool bounceOffGround(float& py, float& vx, float& vy, float r) {
+    py = r;
+    vx *= 0.5f; // Dampen velocity (bounce)
+    vy *= 0.5f;
+
+    // If velocity is very low, make the projectile inactive.
+    // length(v) < 1 is exactly |v|^2 < 1 for a correctly rounded sqrt.
+    if (vx * vx + vy * vy < 1.0f) {
+        return false;
+    }
+    vy = -vy * 0.7f; // Bounce with energy loss
+    return true;
+}
+
+// Bounce at the moment of wall contact
+inline void bounceOffWall(float& px, float& vx, float r) {
+    px = WINDOW_WIDTH - r;
+    vx *= -WALL_RESTITUTION; // Bounce off wall
+}
+
+// How a step ended: still flying, settled on the ground, or stopped at an
+// impact the caller asked for
+enum class StepEnd { Flying, Settled, Stopped };
+
+// atImpact for steps that bounce at every impact, as the game's do
+struct BounceAtEveryImpact {
+    bool operator()(float, float, bool, float) const { return false; }
+};
+
+// Continuous collision for one step: flies the arc to the first time of impact
+// with the ground or the right wall, bounces there, and repeats for the rest of
+// the step, so no step size can carry a shell through either.
+//
+// Before each bounce it calls atImpact(x, y, ground, elapsed) with the point of
+// contact, whether it is the ground's, and the seconds into the step. If that
+// returns true the step stops there, the shell left at the impact unbounced.
+// This is how tools find where a shot lands with the game's own calls.
+template <typename AtImpact>
+inline StepEnd sweepProjectileUntil(float& px, float& py, float& vx, float& vy, float r, float deltaTime,
+                                    AtImpact atImpact) {
+    float remaining = deltaTime;
+    float elapsed = 0.0f;
+    for (int bounce = 0;; ++bounce) {
+        float groundTime = timeToGround(py - r, vy);
+        float wallTime = timeToWall(px, vx, r);
+        float impactTime = std::fmin(groundTime, wallTime);
+        if (impactTime >= remaining || bounce == MAX_BOUNCES_PER_STEP) {
+            // Rounding can leave a root just past an end point that is in contact
+            flyProjectile(px, py, vx, vy, remaining);
+            py = std::fmax(py, r);
+            if (vx > 0.0f) {
+                px = std::fmin(px, WINDOW_WIDTH - r);
+            }
+            return StepEnd::Flying;
+        }
+        flyProjectile(px, py, vx, vy, impactTime);
+        remaining -= impactTime;
+        elapsed += impactTime;
+
+        bool ground = groundTime <= wallTime;
+        if (atImpact(ground ? px : WINDOW_WIDTH - r, ground ? r : py, ground, elapsed)) {
+            return StepEnd::Stopped;
+        }
+        if (ground) {
+            if (!bounceOffGround(py, vx, vy, r)) {
+                return StepEnd::Settled;
+            }
+        } else {
+            bounceOffWall(px, vx, r);
+        }
+    }
+}
+
+// The sweep as the game steps it. Returns false if the shell settled on the ground.
+inline bool sweepProjectile(float& px, float& py, float& vx, float& vy, float r, float deltaTime) {
+    return sweepProjectileUntil(px, py, vx, vy, r, deltaTime, BounceAtEveryImpact()) == StepEnd::Flying;
+}
+
+// One step for one active shell: plain flight when the end point is clear of
+// the ground and wall (the arc is concave and the x motion linear, so then the
+// whole step is), the sweep from the start otherwise
+template <typename AtImpact>
+inline StepEnd advanceProjectileUntil(float& px, float& py, float& vx, float& vy, float r, float deltaTime,
+                                      AtImpact atImpact) {
+    float endX = px;
+    float endY = py;
+    float endVy = vy;
+    flyProjectile(endX, endY, vx, endVy, deltaTime);
+    if (!projectileInContact(endX, endY, r)) {
+        px = endX;
+        py = endY;
+        vy = endVy;
+        return StepEnd::Flying;
+    }
+    return sweepProjectileUntil(px, py, vx, vy, r, deltaTime, atImpact);
+}
+
+// The step as the game takes it. Returns false if the shell settled.
+inline bool advanceProjectile(float& px, float& py, float& vx, float& vy, float r, float deltaTime) {
+    return advanceProjectileUntil(px, py, vx, vy, r, deltaTime, BounceAtEveryImpact()) != StepEnd::Settled;
+}
+
+// Projectile class
+class Projectile {
+public:
+    glm::vec2 position;
+    glm::vec2 velocity;
+    float radius;
+    bool active;
+    float timeAlive;
+
+    Projectile(glm::vec2 pos, glm::vec2 vel, float r)
+        : position(pos), velocity(vel), radius(r), active(true), timeAlive(0.0f) {}
+
+    void update(float deltaTime) {
+        updateUntil(deltaTime, BounceAtEveryImpact());
+    }
+
+    // update(), stopping at the first impact atImpact accepts (see
+    // sweepProjectileUntil). Returns true if it stopped at one.
+    template <typename AtImpact>
+    bool updateUntil(float deltaTime, AtImpact atImpact) {
+        // Increase time alive
+        timeAlive += deltaTime;
+
+        // Fly the step, bouncing off the ground and wall wherever the arc meets them
+        StepEnd end = advanceProjectileUntil(position.x, position.y, velocity.x, velocity.y, radius, deltaTime,
+                                             atImpact);
+        active = end != StepEnd::Settled;
+        return end == StepEnd::Stopped;
+    }
+
+    // Same physics as update(), applied to every active projectile in a
+    // structure-of-arrays span (defined in projectile_store.h)
+    static void update(const ProjectileSpan& span, float deltaTime);
+};
+
+// Distance from the cannon's pivot to the muzzle, and the radius of its shells
+const float BARREL_LENGTH = 40.0f;
+const float SHELL_RADIUS = 5.0f;
+
+// Aim limits on the cannon, in degrees above the horizon and muzzle speed
+const float MIN_CANNON_ANGLE = 0.0f;
+const float MAX_CANNON_ANGLE = 90.0f;
+const float MIN_CANNON_POWER = 10.0f;
+const float MAX_CANNON_POWER = 100.0f;
+
+// Shell leaving the barrel of a cannon at cannonPos aimed `angle` degrees
+// above the horizon with muzzle speed `power`
+inline Projectile launchProjectile(glm::vec2 cannonPos, float angle, float power) {
+    // Calculate initial velocity based on angle and power
+    float radianAngle = angle * PI / 180.0f;
+    glm::vec2 initialVelocity(
+        power * cos(radianAngle),
+        power * sin(radianAngle)
+    );
+    
+    // Calculate the barrel end position
+    glm::vec2 barrelEnd(
+        cannonPos.x + BARREL_LENGTH * cos(radianAngle),
+        cannonPos.y + BARREL_LENGTH * sin(radianAngle)
+    );
+    
+    return Projectile(barrelEnd, initialVelocity, SHELL_RADIUS);
+}
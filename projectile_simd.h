@@ -0,0 +1,278 @@
+#pragma once
+
+#include "projectile_store.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CANNON_SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// Explicit SIMD versions of Projectile::update(span, dt), 4/8/16 projectiles per
+// instruction. They perform the scalar path's operations in the same order and
+// never contract into FMA, so on IEEE hardware they agree with it bit for bit.
+// SIMD_UPDATE_TOLERANCE (max absolute error in any field after the 600 steps of
+// compareUpdateKernelWithScalar) only absorbs FMA contraction when the scalar
+// path is built with -mfma/-march=native, where a*b+c rounds once instead of twice.
+const float SIMD_UPDATE_TOLERANCE = 1e-2f;
+
+enum class SimdLevel { Scalar, SSE2, AVX2, AVX512 };
+
+typedef void (*ProjectileUpdateKernel)(const ProjectileSpan& span, float deltaTime);
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    default: return "scalar";
+    }
+}
+
+inline void updateProjectilesScalar(const ProjectileSpan& span, float deltaTime) {
+    Projectile::update(span, deltaTime);
+}
+
+#ifdef CANNON_SIMD_X86
+
+// Highest level both the CPU and the OS (saved YMM/ZMM state) support
+inline SimdLevel detectSimdLevel() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & bit_SSE2)) {
+        return SimdLevel::Scalar;
+    }
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+        return SimdLevel::SSE2;
+    }
+
+    unsigned xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if ((xcr0Low & 0x6) != 0x6) {
+        return SimdLevel::SSE2;
+    }
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return SimdLevel::SSE2;
+    }
+    if ((ebx & bit_AVX512F) && (xcr0Low & 0xE6) == 0xE6) {
+        return SimdLevel::AVX512;
+    }
+    if (ebx & bit_AVX2) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+}
+
+// GCC implements the arithmetic intrinsics as plain vector operators, which it
+// will contract into FMA wherever the target allows it (avx512f implies fma)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// Lanes in contact keep their start state in the vector pass; this sweeps them
+inline void sweepContactLanes(const ProjectileSpan& span, std::size_t first, unsigned lanes, float deltaTime) {
+    while (lanes) {
+        sweepProjectileAt(span, first + __builtin_ctz(lanes), deltaTime);
+        lanes &= lanes - 1;
+    }
+}
+
+__attribute__((target("sse2")))
+inline void updateProjectilesSSE2(const ProjectileSpan& span, float deltaTime) {
+    const __m128 dtAll = _mm_set1_ps(deltaTime);
+    const __m128 gravity = _mm_set1_ps(GRAVITY);
+    const __m128 halfGravity = _mm_set1_ps(0.5f * GRAVITY);
+    const __m128 width = _mm_set1_ps(static_cast<float>(WINDOW_WIDTH));
+    const __m128i zero = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    for (; i + 4 <= span.count; i += 4) {
+        std::int32_t activeBytes;
+        std::memcpy(&activeBytes, span.active + i, sizeof(activeBytes));
+        __m128i flags = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(activeBytes), zero), zero);
+        __m128 live = _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(flags, zero), _mm_set1_epi32(-1)));
+
+        __m128 dt = _mm_and_ps(live, dtAll);
+        __m128 r = _mm_loadu_ps(span.radius + i);
+
+        // Apply gravity and integrate
+        __m128 startX = _mm_loadu_ps(span.posX + i);
+        __m128 startY = _mm_loadu_ps(span.posY + i);
+        __m128 startVy = _mm_loadu_ps(span.velY + i);
+        __m128 vx = _mm_loadu_ps(span.velX + i);
+        __m128 px = _mm_add_ps(startX, _mm_mul_ps(vx, dt));
+        __m128 py = _mm_sub_ps(_mm_add_ps(startY, _mm_mul_ps(startVy, dt)), _mm_mul_ps(_mm_mul_ps(halfGravity, dt), dt));
+        __m128 vy = _mm_sub_ps(startVy, _mm_mul_ps(gravity, dt));
+        __m128 t = _mm_add_ps(_mm_loadu_ps(span.timeAlive + i), dt);
+
+        // Ground or wall at the end point: keep the start state for the sweep
+        __m128 touching = _mm_and_ps(live, _mm_or_ps(_mm_cmple_ps(py, r), _mm_cmpge_ps(px, _mm_sub_ps(width, r))));
+        px = _mm_or_ps(_mm_and_ps(touching, startX), _mm_andnot_ps(touching, px));
+        py = _mm_or_ps(_mm_and_ps(touching, startY), _mm_andnot_ps(touching, py));
+        vy = _mm_or_ps(_mm_and_ps(touching, startVy), _mm_andnot_ps(touching, vy));
+
+        _mm_storeu_ps(span.posX + i, px);
+        _mm_storeu_ps(span.posY + i, py);
+        _mm_storeu_ps(span.velY + i, vy);
+        _mm_storeu_ps(span.timeAlive + i, t);
+        sweepContactLanes(span, i, static_cast<unsigned>(_mm_movemask_ps(touching)), deltaTime);
+    }
+
+    Projectile::update(span.subspan(i, span.count - i), deltaTime);
+}
+
+__attribute__((target("avx2")))
+inline void updateProjectilesAVX2(const ProjectileSpan& span, float deltaTime) {
+    const __m256 dtAll = _mm256_set1_ps(deltaTime);
+    const __m256 gravity = _mm256_set1_ps(GRAVITY);
+    const __m256 halfGravity = _mm256_set1_ps(0.5f * GRAVITY);
+    const __m256 width = _mm256_set1_ps(static_cast<float>(WINDOW_WIDTH));
+
+    std::size_t i = 0;
+    for (; i + 8 <= span.count; i += 8) {
+        __m256i flags = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(span.active + i)));
+        __m256 live = _mm256_castsi256_ps(_mm256_cmpgt_epi32(flags, _mm256_setzero_si256()));
+
+        __m256 dt = _mm256_and_ps(live, dtAll);
+        __m256 r = _mm256_loadu_ps(span.radius + i);
+
+        // Apply gravity and integrate
+        __m256 startX = _mm256_loadu_ps(span.posX + i);
+        __m256 startY = _mm256_loadu_ps(span.posY + i);
+        __m256 startVy = _mm256_loadu_ps(span.velY + i);
+        __m256 vx = _mm256_loadu_ps(span.velX + i);
+        __m256 px = _mm256_add_ps(startX, _mm256_mul_ps(vx, dt));
+        __m256 py = _mm256_sub_ps(_mm256_add_ps(startY, _mm256_mul_ps(startVy, dt)),
+                                  _mm256_mul_ps(_mm256_mul_ps(halfGravity, dt), dt));
+        __m256 vy = _mm256_sub_ps(startVy, _mm256_mul_ps(gravity, dt));
+        __m256 t = _mm256_add_ps(_mm256_loadu_ps(span.timeAlive + i), dt);
+
+        // Ground or wall at the end point: keep the start state for the sweep
+        __m256 touching = _mm256_and_ps(live, _mm256_or_ps(_mm256_cmp_ps(py, r, _CMP_LE_OQ),
+                                                           _mm256_cmp_ps(px, _mm256_sub_ps(width, r), _CMP_GE_OQ)));
+        px = _mm256_blendv_ps(px, startX, touching);
+        py = _mm256_blendv_ps(py, startY, touching);
+        vy = _mm256_blendv_ps(vy, startVy, touching);
+
+        _mm256_storeu_ps(span.posX + i, px);
+        _mm256_storeu_ps(span.posY + i, py);
+        _mm256_storeu_ps(span.velY + i, vy);
+        _mm256_storeu_ps(span.timeAlive + i, t);
+        sweepContactLanes(span, i, static_cast<unsigned>(_mm256_movemask_ps(touching)), deltaTime);
+    }
+
+    Projectile::update(span.subspan(i, span.count - i), deltaTime);
+}
+
+__attribute__((target("avx512f")))
+inline void updateProjectilesAVX512(const ProjectileSpan& span, float deltaTime) {
+    const __m512 dtAll = _mm512_set1_ps(deltaTime);
+    const __m512 gravity = _mm512_set1_ps(GRAVITY);
+    const __m512 halfGravity = _mm512_set1_ps(0.5f * GRAVITY);
+    const __m512 width = _mm512_set1_ps(static_cast<float>(WINDOW_WIDTH));
+
+    std::size_t i = 0;
+    for (; i + 16 <= span.count; i += 16) {
+        __m512i flags = _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(span.active + i)));
+        __mmask16 live = _mm512_test_epi32_mask(flags, flags);
+
+        __m512 dt = _mm512_maskz_mov_ps(live, dtAll);
+        __m512 r = _mm512_loadu_ps(span.radius + i);
+
+        // Apply gravity and integrate
+        __m512 startX = _mm512_loadu_ps(span.posX + i);
+        __m512 startY = _mm512_loadu_ps(span.posY + i);
+        __m512 startVy = _mm512_loadu_ps(span.velY + i);
+        __m512 vx = _mm512_loadu_ps(span.velX + i);
+        __m512 px = _mm512_add_ps(startX, _mm512_mul_ps(vx, dt));
+        __m512 py = _mm512_sub_ps(_mm512_add_ps(startY, _mm512_mul_ps(startVy, dt)),
+                                  _mm512_mul_ps(_mm512_mul_ps(halfGravity, dt), dt));
+        __m512 vy = _mm512_sub_ps(startVy, _mm512_mul_ps(gravity, dt));
+        __m512 t = _mm512_add_ps(_mm512_loadu_ps(span.timeAlive + i), dt);
+
+        // Ground or wall at the end point: keep the start state for the sweep
+        __mmask16 touching = _mm512_mask_cmp_ps_mask(live, py, r, _CMP_LE_OQ) |
+                             _mm512_mask_cmp_ps_mask(live, px, _mm512_sub_ps(width, r), _CMP_GE_OQ);
+        px = _mm512_mask_blend_ps(touching, px, startX);
+        py = _mm512_mask_blend_ps(touching, py, startY);
+        vy = _mm512_mask_blend_ps(touching, vy, startVy);
+
+        _mm512_storeu_ps(span.posX + i, px);
+        _mm512_storeu_ps(span.posY + i, py);
+        _mm512_storeu_ps(span.velY + i, vy);
+        _mm512_storeu_ps(span.timeAlive + i, t);
+        sweepContactLanes(span, i, touching, deltaTime);
+    }
+
+    Projectile::update(span.subspan(i, span.count - i), deltaTime);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+inline ProjectileUpdateKernel selectUpdateKernel(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::SSE2: return updateProjectilesSSE2;
+    case SimdLevel::AVX2: return updateProjectilesAVX2;
+    case SimdLevel::AVX512: return updateProjectilesAVX512;
+    default: return updateProjectilesScalar;
+    }
+}
+
+#else
+
+inline SimdLevel detectSimdLevel() {
+    return SimdLevel::Scalar;
+}
+
+inline ProjectileUpdateKernel selectUpdateKernel(SimdLevel) {
+    return updateProjectilesScalar;
+}
+
+#endif
+
+// Runs `kernel` and the scalar path side by side over the same randomized
+// projectiles (count chosen to leave a tail for every vector width) and returns
+// the largest absolute difference in any float field, or INFINITY if the two
+// ever disagree about which projectiles are active.
+inline float compareUpdateKernelWithScalar(ProjectileUpdateKernel kernel,
+                                           std::size_t count = 1027, int steps = 600) {
+    ProjectileStore expected;
+    ProjectileStore actual;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (std::size_t i = 0; i < count; ++i) {
+        Projectile projectile(glm::vec2(unit(rng) * WINDOW_WIDTH, unit(rng) * WINDOW_HEIGHT),
+                              glm::vec2(unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 100.0f),
+                              2.0f + unit(rng) * 8.0f);
+        projectile.active = unit(rng) < 0.9f;
+        expected.push(projectile);
+        actual.push(projectile);
+    }
+
+    float maxError = 0.0f;
+    for (int step = 0; step < steps; ++step) {
+        float deltaTime = 1.0f / 60.0f + (step % 7) * 0.004f;
+        Projectile::update(expected.span(), deltaTime);
+        kernel(actual.span(), deltaTime);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (expected.active()[i] != actual.active()[i]) {
+                return INFINITY;
+            }
+            maxError = std::fmax(maxError, std::fabs(expected.posX()[i] - actual.posX()[i]));
+            maxError = std::fmax(maxError, std::fabs(expected.posY()[i] - actual.posY()[i]));
+            maxError = std::fmax(maxError, std::fabs(expected.velX()[i] - actual.velX()[i]));
+            maxError = std::fmax(maxError, std::fabs(expected.velY()[i] - actual.velY()[i]));
+            maxError = std::fmax(maxError, std::fabs(expected.timeAlive()[i] - actual.timeAlive()[i]));
+        }
+    }
+    return maxError;
+}
@@ -0,0 +1,564 @@
+#pragma once
+
+#include "aligned_array.h"
+#include "fixed_projectile.h"
+#include "projectile.h"
+#include "slot_map.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+// Non-owning view of a contiguous range of projectiles, one pointer per field.
+// This is what the update kernels work on; offsets into it are projectile indices.
+struct ProjectileSpan {
+    float* posX;
+    float* posY;
+    float* velX;
+    float* velY;
+    const float* radius;
+    float* timeAlive;
+    std::uint8_t* active;
+    std::size_t count;
+
+    ProjectileSpan subspan(std::size_t offset, std::size_t length) const {
+        return ProjectileSpan{posX + offset, posY + offset, velX + offset, velY + offset,
+                              radius + offset, timeAlive + offset, active + offset, length};
+    }
+};
+
+// Stable reference to a projectile; detects when the projectile is gone
+typedef SlotHandle<Projectile> ProjectileHandle;
+
+// Structure-of-arrays projectile storage: each field lives in its own aligned
+// column so a pass only streams the fields it reads or writes.
+// Columns are dense (no holes); a generational slot map hands out stable
+// ProjectileHandles, so removal is a swap with the last projectile.
+class ProjectileStore {
+public:
+    // Read-only accessor for one projectile
+    class ConstRef {
+    public:
+        ConstRef(const ProjectileStore* store, std::size_t index) : store_(store), index_(index) {}
+
+        std::size_t index() const { return index_; }
+        ProjectileHandle handle() const { return store_->slots_.handleAt(index_); }
+        glm::vec2 position() const { return glm::vec2(store_->posX_[index_], store_->posY_[index_]); }
+        glm::vec2 velocity() const { return glm::vec2(store_->velX_[index_], store_->velY_[index_]); }
+        glm::vec2 previousPosition() const { return glm::vec2(store_->prevX_[index_], store_->prevY_[index_]); }
+        // Position blended between the last two simulation steps, alpha in [0, 1]
+        glm::vec2 interpolatedPosition(float alpha) const {
+            return previousPosition() + (position() - previousPosition()) * alpha;
+        }
+        float radius() const { return store_->radius_[index_]; }
+        float timeAlive() const { return store_->timeAlive_[index_]; }
+        bool active() const { return store_->active_[index_] != 0; }
+        Projectile load() const { return store_->get(index_); }
+
+    private:
+        const ProjectileStore* store_;
+        std::size_t index_;
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = ConstRef;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = ConstRef;
+
+        const_iterator(const ProjectileStore* store, std::size_t index) : store_(store), index_(index) {}
+
+        ConstRef operator*() const { return ConstRef(store_, index_); }
+        ConstRef operator[](difference_type n) const { return ConstRef(store_, index_ + n); }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++index_; return it; }
+        const_iterator& operator--() { --index_; return *this; }
+        const_iterator& operator+=(difference_type n) { index_ += n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(store_, index_ + n); }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+        }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+        bool operator<(const const_iterator& other) const { return index_ < other.index_; }
+
+    private:
+        const ProjectileStore* store_;
+        std::size_t index_;
+    };
+
+    ProjectileStore() {}
+
+    ProjectileStore(const ProjectileStore&) = delete;
+    ProjectileStore& operator=(const ProjectileStore&) = delete;
+
+    std::size_t size() const { return active_.size(); }
+    bool empty() const { return size() == 0; }
+
+    void reserve(std::size_t capacity) {
+        forEachColumn([capacity](auto& column) { column.reserve(capacity); });
+        slots_.reserve(capacity);
+        if (backing_ && !active_.borrowed() && !slots_.borrowed()) {
+            backing_.reset(); // everything has moved out of the adopted memory
+        }
+    }
+
+    void clear() {
+        forEachColumn([](auto& column) { column.clear(); });
+        slots_.clear();
+    }
+
+    // O(1) append; the handle stays valid until the projectile is erased
+    ProjectileHandle push(const Projectile& projectile) {
+        if (backing_ && size() == active_.capacity()) {
+            reserve(std::max<std::size_t>(256, 2 * size()));
+        }
+        posX_.push_back(projectile.position.x);
+        posY_.push_back(projectile.position.y);
+        velX_.push_back(projectile.velocity.x);
+        velY_.push_back(projectile.velocity.y);
+        radius_.push_back(projectile.radius);
+        timeAlive_.push_back(projectile.timeAlive);
+        active_.push_back(projectile.active ? 1 : 0);
+        prevX_.push_back(projectile.position.x);
+        prevY_.push_back(projectile.position.y);
+#if CANNON_FIXED_POINT
+        fixedX_.push_back(SimFixed::fromFloat(projectile.position.x));
+        fixedY_.push_back(SimFixed::fromFloat(projectile.position.y));
+        fixedVelX_.push_back(SimFixed::fromFloat(projectile.velocity.x));
+        fixedVelY_.push_back(SimFixed::fromFloat(projectile.velocity.y));
+        fixedRadius_.push_back(SimFixed::fromFloat(projectile.radius));
+#endif
+        return slots_.insert();
+    }
+
+#if CANNON_FIXED_POINT
+    // Appends a shell whose fixed-point state is exactly `projectile`; the float
+    // columns get the nearest floats
+    ProjectileHandle push(const FixedProjectile<SimFixed>& projectile) {
+        ProjectileHandle handle = push(Projectile(glm::vec2(projectile.x.toFloat(), projectile.y.toFloat()),
+                                                  glm::vec2(projectile.velX.toFloat(), projectile.velY.toFloat()),
+                                                  projectile.radius.toFloat()));
+        std::size_t last = size() - 1;
+        fixedX_[last] = projectile.x;
+        fixedY_[last] = projectile.y;
+        fixedVelX_[last] = projectile.velX;
+        fixedVelY_[last] = projectile.velY;
+        fixedRadius_[last] = projectile.radius;
+        return handle;
+    }
+#endif
+
+    // Dense index of a live handle, or npos if the projectile has been erased
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+    std::size_t find(ProjectileHandle handle) const {
+        std::uint32_t dense = slots_.find(handle);
+        return dense == SlotMap<Projectile>::npos ? npos : dense;
+    }
+    bool contains(ProjectileHandle handle) const { return slots_.contains(handle); }
+    ProjectileHandle handleAt(std::size_t i) const { return slots_.handleAt(i); }
+
+    Projectile get(std::size_t i) const {
+        Projectile projectile(glm::vec2(posX_[i], posY_[i]), glm::vec2(velX_[i], velY_[i]), radius_[i]);
+        projectile.timeAlive = timeAlive_[i];
+        projectile.active = active_[i] != 0;
+        return projectile;
+    }
+
+    void set(std::size_t i, const Projectile& projectile) {
+        posX_[i] = projectile.position.x;
+        posY_[i] = projectile.position.y;
+        velX_[i] = projectile.velocity.x;
+        velY_[i] = projectile.velocity.y;
+        radius_[i] = projectile.radius;
+        timeAlive_[i] = projectile.timeAlive;
+        active_[i] = projectile.active ? 1 : 0;
+        prevX_[i] = projectile.position.x;
+        prevY_[i] = projectile.position.y;
+#if CANNON_FIXED_POINT
+        fixedX_[i] = SimFixed::fromFloat(projectile.position.x);
+        fixedY_[i] = SimFixed::fromFloat(projectile.position.y);
+        fixedVelX_[i] = SimFixed::fromFloat(projectile.velocity.x);
+        fixedVelY_[i] = SimFixed::fromFloat(projectile.velocity.y);
+        fixedRadius_[i] = SimFixed::fromFloat(projectile.radius);
+#endif
+    }
+
+    // Snapshot current positions as the interpolation origin; call before each fixed step
+    void savePreviousPositions() { savePreviousPositions(0, size()); }
+
+    // The same for [begin, end) only, for passes split across threads
+    void savePreviousPositions(std::size_t begin, std::size_t end) {
+        if (begin < end) {
+            std::memcpy(prevX_.data() + begin, posX_.data() + begin, (end - begin) * sizeof(float));
+            std::memcpy(prevY_.data() + begin, posY_.data() + begin, (end - begin) * sizeof(float));
+        }
+    }
+
+    ProjectileSpan span() {
+        return ProjectileSpan{posX_.data(), posY_.data(), velX_.data(), velY_.data(),
+                              radius_.data(), timeAlive_.data(), active_.data(), size()};
+    }
+
+#if CANNON_FIXED_POINT
+    // The authoritative state in fixed-point mode; shares span()'s active column
+    FixedProjectileSpan<SimFixed> fixedSpan() {
+        return FixedProjectileSpan<SimFixed>{fixedX_.data(), fixedY_.data(), fixedVelX_.data(), fixedVelY_.data(),
+                                             fixedRadius_.data(), active_.data(), size()};
+    }
+
+    // Rebuilds the fixed-point columns from the float ones written through span()
+    void refreshFixedColumns() { refreshFixedColumns(0, size()); }
+
+    void refreshFixedColumns(std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            fixedX_[i] = SimFixed::fromFloat(posX_[i]);
+            fixedY_[i] = SimFixed::fromFloat(posY_[i]);
+            fixedVelX_[i] = SimFixed::fromFloat(velX_[i]);
+            fixedVelY_[i] = SimFixed::fromFloat(velY_[i]);
+            fixedRadius_[i] = SimFixed::fromFloat(radius_[i]);
+        }
+    }
+#endif
+
+    ConstRef operator[](std::size_t i) const { return ConstRef(this, i); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // Column access for passes that stream a single field
+    const float* posX() const { return posX_.data(); }
+    const float* posY() const { return posY_.data(); }
+    const float* velX() const { return velX_.data(); }
+    const float* velY() const { return velY_.data(); }
+    const float* radius() const { return radius_.data(); }
+    const float* timeAlive() const { return timeAlive_.data(); }
+    const std::uint8_t* active() const { return active_.data(); }
+    const float* prevX() const { return prevX_.data(); }
+    const float* prevY() const { return prevY_.data(); }
+
+    // O(1) removal: the last projectile moves into slot i, so dense order is not preserved
+    void eraseAt(std::size_t i) {
+        std::size_t last = size() - 1;
+        if (i != last) {
+            forEachColumn([i, last](auto& column) { column[i] = column[last]; });
+        }
+        forEachColumn([last](auto& column) { column.resize(last); });
+        slots_.eraseAt(i);
+    }
+
+    // Marks a projectile for the next eraseIf(!active) without moving anything yet
+    bool deactivate(ProjectileHandle handle) {
+        std::size_t i = find(handle);
+        if (i == npos) {
+            return false;
+        }
+        active_[i] = 0;
+        return true;
+    }
+
+    bool erase(ProjectileHandle handle) {
+        std::size_t i = find(handle);
+        if (i == npos) {
+            return false;
+        }
+        eraseAt(i);
+        return true;
+    }
+
+    // Drops every projectile for which pred(ConstRef) is true. Walks backwards so
+    // whatever eraseAt swaps in has already been tested; each removal is O(1).
+    template <typename Pred>
+    void eraseIf(Pred pred) {
+        for (std::size_t i = size(); i-- > 0;) {
+            if (pred(ConstRef(this, i))) {
+                eraseAt(i);
+            }
+        }
+    }
+
+    // Every column's raw contents in a fixed order, for keyframes. Handles are
+    // not saved: readColumns hands out new ones in dense order.
+    void writeColumns(std::ostream& out) const {
+        forEachColumnOf(*this, [&out](const auto& column) {
+            out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(column[0]));
+        });
+    }
+
+    // Calls f(column) for each column (an AlignedArray) in writeColumns order
+    template <typename F>
+    void visitColumns(F f) const {
+        forEachColumnOf(*this, f);
+    }
+
+    // Replaces the contents with `count` projectiles copied from column images
+    // laid out as writeColumns writes them; source(k) is the k-th column's image
+    template <typename Source>
+    void assignColumns(std::size_t count, Source source) {
+        reset(count);
+        copyColumns(count, source);
+    }
+
+    // The same, with the handles the projectiles had when saveHandles wrote
+    // `handleImage` (the slot map restored exactly, see SlotMap::loadImage)
+    template <typename Source>
+    void assignColumns(std::size_t count, Source source, const unsigned char* handleImage) {
+        assignColumns(count, source, handleImage, [](void* to, const void* from, std::size_t bytes) {
+            std::memcpy(to, from, bytes);
+        });
+    }
+
+    // The same, copying each column with copy(to, from, bytes) (one that
+    // splits the copy across threads, say)
+    template <typename Source, typename Copy>
+    void assignColumns(std::size_t count, Source source, const unsigned char* handleImage, Copy copy) {
+        forEachColumn([count](auto& column) { column.resize(count); });
+        slots_.loadImage(handleImage);
+        std::size_t k = 0;
+        forEachColumn([&](auto& column) {
+            if (count > 0) {
+                copy(column.data(), source(k), count * sizeof(column[0]));
+            }
+            ++k;
+        });
+    }
+
+    // Replaces the contents with `count` projectiles whose columns stay where
+    // they are, laid out as writeColumns writes them; source(k) is the k-th
+    // column, aligned to PROJECTILE_ALIGNMENT and writable. Handles come from
+    // `handleImage` as for assignColumns, and the slot map adopts that too.
+    // The store works on all of it in place and keeps `backing` (whatever
+    // owns it) alive until it has outgrown it.
+    template <typename Source>
+    void adoptColumns(std::size_t count, Source source, unsigned char* handleImage, std::shared_ptr<void> backing) {
+        std::size_t k = 0;
+        forEachColumn([&](auto& column) {
+            typedef typename std::remove_reference<decltype(column[0])>::type Element;
+            column.adopt(reinterpret_cast<Element*>(source(k++)), count);
+        });
+        slots_.adoptImage(handleImage);
+        backing_ = std::move(backing);
+    }
+
+    // The store's handles as bytes, for assignColumns
+    std::size_t handleBytes() const { return slots_.imageBytes(); }
+    // Every handle's index is below this
+    std::size_t slotCount() const { return slots_.slotCount(); }
+    void saveHandles(unsigned char* out) const { slots_.saveImage(out); }
+    // handleAt(i) of the store that saveHandles wrote `handleImage`
+    static ProjectileHandle savedHandleAt(const unsigned char* handleImage, std::size_t i) {
+        return SlotMap<Projectile>::imageHandleAt(handleImage, i);
+    }
+
+    // Replaces the contents with `count` projectiles under fresh handles whose
+    // fields are uninitialized; fill them in with set(), or in bulk through
+    // span() and radiusColumn() followed by savePreviousPositions()
+    void reset(std::size_t count) {
+        clear();
+        forEachColumn([count](auto& column) { column.resize(count); });
+        slots_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            slots_.insert();
+        }
+    }
+
+    // The same, under the handles handleAt(i) returns (see SlotMap::assign)
+    // instead of fresh ones
+    template <typename HandleAt>
+    void reset(std::size_t count, HandleAt handleAt) {
+        forEachColumn([count](auto& column) { column.resize(count); });
+        slots_.assign(count, handleAt);
+    }
+
+    // span() leaves radius read-only; this is for filling a reset() store
+    float* radiusColumn() { return radius_.data(); }
+
+    // Bytes writeColumns writes per projectile
+    std::size_t bytesPerProjectile() const {
+        std::size_t bytes = 0;
+        forEachColumnOf(*this, [&bytes](const auto& column) { bytes += sizeof(column[0]); });
+        return bytes;
+    }
+
+    // FNV-1a over every column: equal hashes mean two runs reached the same state
+    // to the last bit (in fixed-point builds, the fixed-point state included)
+    std::uint64_t hash() const {
+        std::uint64_t result = 14695981039346656037ull;
+        forEachColumnOf(*this, [&result](const auto& column) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(column.data());
+            for (std::size_t i = 0; i < column.size() * sizeof(column[0]); ++i) {
+                result = (result ^ bytes[i]) * 1099511628211ull;
+            }
+        });
+        return result;
+    }
+
+    // Replaces the contents with `count` projectiles written by writeColumns
+    bool readColumns(std::istream& in, std::size_t count) {
+        clear();
+        forEachColumn([&in, count](auto& column) {
+            column.resize(count);
+            in.read(reinterpret_cast<char*>(column.data()), count * sizeof(column[0]));
+        });
+        for (std::size_t i = 0; i < count; ++i) {
+            slots_.insert();
+        }
+        if (!in) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    template <typename Source>
+    void copyColumns(std::size_t count, Source source) {
+        std::size_t k = 0;
+        forEachColumn([&](auto& column) {
+            if (count > 0) {
+                std::memcpy(column.data(), source(k), count * sizeof(column[0]));
+            }
+            ++k;
+        });
+    }
+
+    template <typename F>
+    void forEachColumn(F f) {
+        forEachColumnOf(*this, f);
+    }
+
+    // Shared by const and non-const callers, so the column list is written once
+    template <typename Store, typename F>
+    static void forEachColumnOf(Store& store, F f) {
+        f(store.posX_);
+        f(store.posY_);
+        f(store.velX_);
+        f(store.velY_);
+        f(store.radius_);
+        f(store.timeAlive_);
+        f(store.active_);
+        f(store.prevX_);
+        f(store.prevY_);
+#if CANNON_FIXED_POINT
+        f(store.fixedX_);
+        f(store.fixedY_);
+        f(store.fixedVelX_);
+        f(store.fixedVelY_);
+        f(store.fixedRadius_);
+#endif
+    }
+
+    AlignedArray<float> posX_;
+    AlignedArray<float> posY_;
+    AlignedArray<float> velX_;
+    AlignedArray<float> velY_;
+    AlignedArray<float> radius_;
+    AlignedArray<float> timeAlive_;
+    AlignedArray<std::uint8_t> active_;
+    AlignedArray<float> prevX_;
+    AlignedArray<float> prevY_;
+#if CANNON_FIXED_POINT
+    AlignedArray<SimFixed> fixedX_;
+    AlignedArray<SimFixed> fixedY_;
+    AlignedArray<SimFixed> fixedVelX_;
+    AlignedArray<SimFixed> fixedVelY_;
+    AlignedArray<SimFixed> fixedRadius_;
+#endif
+    SlotMap<Projectile> slots_;
+    std::shared_ptr<void> backing_; // owner of adopted columns (adoptColumns)
+};
+
+// Projectiles per block of updateProjectileColumns
+const std::size_t UPDATE_BLOCK = 64;
+
+// Sweeps projectile i of a span over one step, from its current state
+inline void sweepProjectileAt(const ProjectileSpan& span, std::size_t i, float deltaTime) {
+    float px = span.posX[i];
+    float py = span.posY[i];
+    float vx = span.velX[i];
+    float vy = span.velY[i];
+    bool stillActive = sweepProjectile(px, py, vx, vy, span.radius[i], deltaTime);
+    span.posX[i] = px;
+    span.posY[i] = py;
+    span.velX[i] = vx;
+    span.velY[i] = vy;
+    span.active[i] = stillActive ? 1 : 0;
+}
+
+// Projectile::update() in two passes per block of UPDATE_BLOCK. The first is
+// branch-free so it auto-vectorizes: every live projectile flies the exact arc,
+// and the ones whose end point touches the ground or wall keep their start
+// state and are flagged. The second sweeps the flagged ones (usually none).
+// Inactive lanes integrate with a zero step and are never flagged.
+// GCC needs -fno-trapping-math to if-convert the float compares; the columns are
+// restrict parameters rather than locals so the no-alias promise is honoured.
+inline void updateProjectileColumns(float* __restrict posX, float* __restrict posY,
+                                    float* __restrict velX, float* __restrict velY,
+                                    const float* __restrict radius, float* __restrict timeAlive,
+                                    std::uint8_t* __restrict active, std::size_t count,
+                                    float deltaTime) {
+    for (std::size_t base = 0; base < count; base += UPDATE_BLOCK) {
+        std::size_t blockCount = std::min(UPDATE_BLOCK, count - base);
+        std::uint8_t contact[UPDATE_BLOCK];
+        unsigned anyContact = 0;
+        for (std::size_t j = 0; j < blockCount; ++j) {
+            std::size_t i = base + j;
+            unsigned live = active[i];
+            float dt = live ? deltaTime : 0.0f;
+            float r = radius[i];
+
+            // Apply gravity and integrate (flyProjectile, inlined by hand)
+            float vx = velX[i];
+            float px = posX[i] + vx * dt;
+            float py = posY[i] + velY[i] * dt - 0.5f * GRAVITY * dt * dt;
+            float vy = velY[i] - GRAVITY * dt;
+            timeAlive[i] += dt;
+
+            unsigned touching = live & ((py <= r) | (px >= WINDOW_WIDTH - r) ? 1u : 0u);
+            posX[i] = touching ? posX[i] : px;
+            posY[i] = touching ? posY[i] : py;
+            velY[i] = touching ? velY[i] : vy;
+            contact[j] = static_cast<std::uint8_t>(touching);
+            anyContact |= touching;
+        }
+        if (anyContact) {
+            ProjectileSpan span{posX, posY, velX, velY, radius, timeAlive, active, count};
+            for (std::size_t j = 0; j < blockCount; ++j) {
+                if (contact[j]) {
+                    sweepProjectileAt(span, base + j, deltaTime);
+                }
+            }
+        }
+    }
+}
+
+inline void Projectile::update(const ProjectileSpan& span, float deltaTime) {
+    updateProjectileColumns(span.posX, span.posY, span.velX, span.velY, span.radius,
+                            span.timeAlive, span.active, span.count, deltaTime);
+}
+
+#if CANNON_FIXED_POINT
+// One fixed-point step of the same projectiles in `span` and `fixed`: the
+// integer state advances, then the float columns are refreshed from it for
+// drawing and queries
+inline void updateFixedProjectileColumns(const ProjectileSpan& span, const FixedProjectileSpan<SimFixed>& fixed,
+                                         SimFixed deltaTime, float deltaSeconds,
+                                         const FixedConstants<SimFixed>& constants) {
+    updateFixedProjectiles(fixed, deltaTime, constants);
+    for (std::size_t i = 0; i < span.count; ++i) {
+        span.posX[i] = fixed.posX[i].toFloat();
+        span.posY[i] = fixed.posY[i].toFloat();
+        span.velX[i] = fixed.velX[i].toFloat();
+        span.velY[i] = fixed.velY[i].toFloat();
+        span.timeAlive[i] += span.active[i] ? deltaSeconds : 0.0f;
+    }
+}
+#endif
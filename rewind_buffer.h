@@ -0,0 +1,605 @@
+#pragma once
+
+#include "job_system.h"
+#include "simulation_state.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Recent history of the stepped world, for scrubbing back a few seconds and
+// trying again. capture() at the top of every frame appends the world to a ring
+// of a fixed byte budget, evicting the oldest frames; rewindTo() restores one.
+//
+// Every KEYFRAME_INTERVAL-th frame is a keyframe: the store's columns, its slot
+// map and the lifetime timer wheel's node pool, copied whole. Frames in between
+// are deltas against their keyframe. Radius never changes, the previous
+// positions are the positions on restore and every shell is active at the top
+// of a frame, so a delta holds only position, velocity and age, as int16
+// offsets from the same shell in the keyframe (quantized to 1/64 px, 1/64 px/s
+// and 1/4096 s; errors do not build up). Shells fired since the keyframe, or
+// that moved out of range, are stored whole with their handle, and the ones
+// fired since with their expiry step too. Keyframes restore exactly; deltas to
+// within the quantization step (in fixed-point builds the fixed-point state is
+// rebuilt from the floats).
+//
+// Restored shells keep their handles, so nothing is rebuilt a shell at a time:
+// a keyframe copies the slot map and the wheel back whole, and a delta
+// reassigns the slot map in one pass (none if the handles are the ones the
+// store already has), copies its keyframe's wheel back, advances it to the
+// delta's step and schedules the shells fired since.
+//
+// The per-shell passes - column copies, quantizing and dequantizing - are
+// split across the job system in REWIND_GRAIN chunks; the slot map, the
+// wheel and the list of shells stored whole are done on the calling thread.
+//
+// The ring and frame index are allocated once by setBudget; the scratch arrays
+// grow only when the projectile count passes its previous peak, so capture
+// does not allocate in steady state.
+class RewindBuffer {
+public:
+    static const std::uint32_t KEYFRAME_INTERVAL = 30;
+    static const std::size_t MAX_FRAMES = 1 << 16;
+
+    RewindBuffer()
+        : oldest_(0), next_(0), head_(0), tail_(0), keyframe_(0), keyframeSerial_(0), sinceKeyframe_(0),
+          forceKeyframe_(true) {}
+
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    // Sets the ring's size and drops all history; 0 turns history off
+    void setBudget(std::size_t bytes) {
+        ring_.resize(bytes / RECORD_ALIGNMENT * RECORD_ALIGNMENT);
+        frames_.resize(bytes > 0 ? MAX_FRAMES : 0);
+        columnSizes_.clear();
+        ProjectileStore().visitColumns([this](const auto& column) { columnSizes_.push_back(sizeof(column[0])); });
+        clear();
+    }
+
+    std::size_t budget() const { return ring_.size(); }
+    bool enabled() const { return ring_.size() > 0; }
+    std::size_t frames() const { return static_cast<std::size_t>(next_ - oldest_); }
+    std::size_t bytesUsed() const {
+        if (frames() == 0) {
+            return 0;
+        }
+        return tail_ > head_ ? tail_ - head_ : ring_.size() - head_ + tail_;
+    }
+    double oldestTime() const { return frames() > 0 ? entry(oldest_).simulatedTime : 0.0; }
+    double newestTime() const { return frames() > 0 ? entry(next_ - 1).simulatedTime : 0.0; }
+
+    void clear() {
+        oldest_ = next_ = 0;
+        head_ = tail_ = 0;
+        forceKeyframe_ = true;
+    }
+
+    // Appends the world as it is now; call at the top of each frame
+    void capture(const SimulationState& state, JobSystem& jobs) {
+        if (!enabled()) {
+            return;
+        }
+        const ProjectileStore& store = state.projectiles;
+        std::size_t count = store.size();
+        bool keyframe = forceKeyframe_ || sinceKeyframe_ >= KEYFRAME_INTERVAL || keyframe_ < oldest_;
+        std::size_t fullCount = 0;
+        std::size_t bytes = sizeof(RecordHeader);
+        if (keyframe) {
+            for (std::size_t size : columnSizes_) {
+                bytes += padded(count * size);
+            }
+            bytes += padded(store.handleBytes()) + padded(state.lifetimeTimers.imageBytes());
+        } else {
+            fullCount = encodeDeltas(state, jobs);
+            bytes += padded(count * sizeof(std::uint32_t)) + QUANTIZED_FIELDS * padded(count * sizeof(std::int16_t)) +
+                     fullCount * sizeof(FullShell);
+        }
+
+        std::size_t offset;
+        if (!allocate(bytes, offset)) {
+            clear(); // a single frame bigger than the whole budget
+            return;
+        }
+        if (!keyframe && keyframe_ < oldest_) {
+            // Making room evicted this delta's keyframe; start over with one next frame
+            forceKeyframe_ = true;
+            return;
+        }
+
+        unsigned char* out = ring_.data() + offset;
+        RecordHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.steps = state.clock.steps();
+        header.simulatedTime = state.clock.simulatedTime();
+        header.accumulator = state.clock.accumulator();
+        header.cannonAngle = state.cannonAngle;
+        header.cannonPower = state.cannonPower;
+        header.collisions = state.collisions ? 1 : 0;
+        header.count = static_cast<std::uint32_t>(count);
+        header.fullCount = static_cast<std::uint32_t>(fullCount);
+        header.handleBytes = keyframe ? store.handleBytes() : 0;
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+
+        if (keyframe) {
+            store.visitColumns([&](const auto& column) {
+                copy(jobs, out, column.data(), count * sizeof(column[0]));
+                out += padded(count * sizeof(column[0]));
+            });
+            store.saveHandles(out);
+            out += padded(header.handleBytes);
+            state.lifetimeTimers.saveImage(out);
+            rememberKeyframe(store, ++keyframeSerial_, jobs);
+        } else {
+            copy(jobs, out, keyIndex_.data(), count * sizeof(std::uint32_t));
+            out += padded(count * sizeof(std::uint32_t));
+            for (int field = 0; field < QUANTIZED_FIELDS; ++field) {
+                copy(jobs, out, quantized_[field].data(), count * sizeof(std::int16_t));
+                out += padded(count * sizeof(std::int16_t));
+            }
+            std::memcpy(out, full_.data(), fullCount * sizeof(FullShell));
+            ++sinceKeyframe_;
+        }
+
+        Frame& frame = entry(next_);
+        frame.offset = offset;
+        frame.bytes = bytes;
+        frame.simulatedTime = header.simulatedTime;
+        frame.keyframe = keyframe ? next_ : keyframe_;
+        if (keyframe) {
+            keyframe_ = next_;
+            sinceKeyframe_ = 1;
+            forceKeyframe_ = false;
+        }
+        ++next_;
+        tail_ = offset + bytes;
+    }
+
+    // Restores the newest frame captured at or before `simulatedTime` (the
+    // oldest one if history does not reach that far) and forgets every frame
+    // from it on, so history continues from the restored world. False if empty.
+    bool rewindTo(double simulatedTime, const SimulationState& state, JobSystem& jobs) {
+        if (frames() == 0) {
+            return false;
+        }
+        std::uint64_t low = oldest_;
+        std::uint64_t high = next_ - 1;
+        while (low < high) {
+            std::uint64_t mid = low + (high - low + 1) / 2;
+            if (entry(mid).simulatedTime <= simulatedTime) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        const Frame& frame = entry(low);
+        if (frame.keyframe == low) {
+            restoreKeyframe(frame, state, jobs);
+        } else {
+            restoreDelta(frame, entry(frame.keyframe), state, jobs);
+        }
+        next_ = low;
+        tail_ = frame.offset;
+        if (next_ == oldest_) {
+            head_ = tail_;
+        }
+        forceKeyframe_ = true; // the keyframe new deltas would refer to may be among the dropped frames
+        return true;
+    }
+
+private:
+    static const std::size_t RECORD_ALIGNMENT = 64;
+    static const int QUANTIZED_FIELDS = 5;
+    static const std::size_t QUANTIZE_BLOCK = 64;
+    // Shells per job when a pass is split across threads; a multiple of
+    // QUANTIZE_BLOCK, so blocks fall where they would in one pass
+    static const std::size_t REWIND_GRAIN = 16384;
+    static const std::size_t COPY_GRAIN = 256 * 1024; // bytes
+    // A delta's keyIndex entry for a shell stored whole is STORED_WHOLE plus
+    // its place among the whole shells; NOT_IN_KEYFRAME only while encoding
+    static const std::uint32_t STORED_WHOLE = 0x80000000u;
+    static const std::uint32_t NOT_IN_KEYFRAME = 0xFFFFFFFFu;
+
+    // Quantization steps of the delta fields, as steps per unit (powers of two,
+    // so scaling is exact)
+    static constexpr float POSITION_SCALE = 64.0f;
+    static constexpr float VELOCITY_SCALE = 64.0f;
+    static constexpr float AGE_SCALE = 4096.0f;
+
+    struct Frame {
+        std::size_t offset;
+        std::size_t bytes;
+        double simulatedTime;
+        std::uint64_t keyframe; // sequence number of the keyframe it is based on
+    };
+
+    struct RecordHeader {
+        std::uint64_t steps;
+        double simulatedTime;
+        double accumulator;
+        float cannonAngle;
+        float cannonPower;
+        std::uint32_t collisions;
+        std::uint32_t count;
+        std::uint32_t fullCount;
+        std::uint32_t reserved;
+        std::uint64_t handleBytes; // of a keyframe's handle image
+    };
+
+    // A shell a delta stores whole. due is its expiry step if it was fired
+    // since the keyframe (the keyframe's wheel has the others), else 0.
+    struct FullShell {
+        float posX;
+        float posY;
+        float velX;
+        float velY;
+        float radius;
+        float timeAlive;
+        ProjectileHandle handle;
+        std::uint64_t due;
+    };
+
+    // Where a keyframe put the live handle in a slot. Entries left over from
+    // other keyframes are told apart by their serial: a rewind can issue a
+    // handle again, and a sequence number too, so neither alone does.
+    struct KeyframeSlot {
+        std::uint32_t generation;
+        std::uint32_t dense;
+        std::uint64_t keyframe;
+    };
+
+    static std::size_t padded(std::size_t bytes) { return (bytes + 7) & ~static_cast<std::size_t>(7); }
+
+    Frame& entry(std::uint64_t sequence) { return frames_[sequence % MAX_FRAMES]; }
+    const Frame& entry(std::uint64_t sequence) const { return frames_[sequence % MAX_FRAMES]; }
+
+    // memcpy in COPY_GRAIN pieces across the job system
+    static void copy(JobSystem& jobs, void* to, const void* from, std::size_t bytes) {
+        jobs.parallelFor(0, bytes, COPY_GRAIN, [&](std::size_t begin, std::size_t end) {
+            std::memcpy(static_cast<unsigned char*>(to) + begin, static_cast<const unsigned char*>(from) + begin,
+                        end - begin);
+        });
+    }
+
+    // Fills due_ with every shell's expiry step (0 if it has no timer)
+    void collectDueSteps(const SimulationState& state) {
+        const ProjectileStore& store = state.projectiles;
+        due_.assign(store.size(), 0);
+        state.lifetimeTimers.forEach([&](unsigned long long due, ProjectileHandle handle) {
+            std::size_t dense = store.find(handle);
+            if (dense != ProjectileStore::npos) {
+                due_[dense] = due;
+            }
+        });
+    }
+
+    // Handles have distinct slots, so chunks write disjoint entries
+    void rememberKeyframe(const ProjectileStore& store, std::uint64_t serial, JobSystem& jobs) {
+        if (keySlots_.size() < store.slotCount()) {
+            keySlots_.resize(store.slotCount(), KeyframeSlot{0, 0, 0});
+        }
+        jobs.parallelFor(0, store.size(), REWIND_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                ProjectileHandle handle = store.handleAt(i);
+                keySlots_[handle.index] = KeyframeSlot{handle.generation, static_cast<std::uint32_t>(i), serial};
+            }
+        });
+    }
+
+    // One field's offset from the keyframe, rounded to int16 steps of 1/scale;
+    // false if it does not fit
+    static bool quantize(float value, float keyValue, float scale, std::int16_t& out) {
+        float steps = (value - keyValue) * scale;
+        bool fits = steps > -32768.0f && steps < 32767.0f;
+        // Offset so the truncating conversion rounds to nearest
+        out = fits ? static_cast<std::int16_t>(static_cast<int>(steps + 32768.5f) - 32768) : 0;
+        return fits;
+    }
+
+    // Offsets of one field from the keyframe; marks the shells whose offset
+    // does not fit. One field per pass keeps the number of streams the
+    // prefetcher has to follow small. Compaction only moves the last shells
+    // into holes, so most blocks sit where they did in the keyframe; those
+    // skip the gather through keyIndex and vectorize.
+    static void quantizeField(const float* values, const float* keyValues, float scale, const std::uint32_t* keyIndex,
+                              std::int16_t* out, std::uint8_t* outOfRange, std::size_t begin, std::size_t end) {
+        for (std::size_t first = begin; first < end; first += QUANTIZE_BLOCK) {
+            std::size_t last = std::min(first + QUANTIZE_BLOCK, end);
+            bool inPlace = true;
+            for (std::size_t i = first; i < last; ++i) {
+                inPlace &= keyIndex[i] == i;
+            }
+            if (inPlace) {
+                for (std::size_t i = first; i < last; ++i) {
+                    outOfRange[i] |= quantize(values[i], keyValues[i], scale, out[i]) ? 0 : 1;
+                }
+                continue;
+            }
+            for (std::size_t i = first; i < last; ++i) {
+                std::uint32_t k = keyIndex[i];
+                float keyValue = k == NOT_IN_KEYFRAME ? values[i] : keyValues[k];
+                outOfRange[i] |= quantize(values[i], keyValue, scale, out[i]) ? 0 : 1;
+            }
+        }
+    }
+
+    // The inverse of quantizeField: out[i] is the keyframe's value plus the
+    // offset (`quantized` null for a field stored without one). Shells stored
+    // whole are left for the caller.
+    static void restoreField(const float* keyValues, const std::int16_t* quantized, float step,
+                             const std::uint32_t* keyIndex, float* out, std::size_t begin, std::size_t end) {
+        for (std::size_t first = begin; first < end; first += QUANTIZE_BLOCK) {
+            std::size_t last = std::min(first + QUANTIZE_BLOCK, end);
+            bool inPlace = true;
+            for (std::size_t i = first; i < last; ++i) {
+                inPlace &= keyIndex[i] == i;
+            }
+            if (inPlace && quantized) {
+                for (std::size_t i = first; i < last; ++i) {
+                    out[i] = keyValues[i] + quantized[i] * step;
+                }
+            } else if (inPlace) {
+                std::memcpy(out + first, keyValues + first, (last - first) * sizeof(float));
+            } else {
+                for (std::size_t i = first; i < last; ++i) {
+                    std::uint32_t k = keyIndex[i];
+                    if (k < STORED_WHOLE) {
+                        out[i] = keyValues[k] + (quantized ? quantized[i] * step : 0.0f);
+                    }
+                }
+            }
+        }
+    }
+
+    // Fills keyIndex_, quantized_ and full_ for a delta; returns the number
+    // stored whole. A shell's expiry step is fixed when it is fired, so only
+    // shells stored whole need theirs looked up.
+    std::size_t encodeDeltas(const SimulationState& state, JobSystem& jobs) {
+        const ProjectileStore& store = state.projectiles;
+        std::size_t count = store.size();
+        keyIndex_.resize(std::max(keyIndex_.size(), count));
+        for (auto& field : quantized_) {
+            field.resize(std::max(field.size(), count));
+        }
+        full_.resize(std::max(full_.size(), count));
+        wholeIndex_.resize(std::max(wholeIndex_.size(), count));
+        outOfRange_.resize(std::max(outOfRange_.size(), count));
+
+        KeyframeColumns columns = keyframeColumns(entry(keyframe_));
+        const float* values[QUANTIZED_FIELDS] = {store.posX(), store.posY(), store.velX(), store.velY(),
+                                                 store.timeAlive()};
+        const float* keyValues[QUANTIZED_FIELDS] = {columns.posX, columns.posY, columns.velX, columns.velY,
+                                                    columns.timeAlive};
+        const float scales[QUANTIZED_FIELDS] = {POSITION_SCALE, POSITION_SCALE, VELOCITY_SCALE, VELOCITY_SCALE,
+                                                AGE_SCALE};
+        jobs.parallelFor(0, count, REWIND_GRAIN, [&](std::size_t begin, std::size_t end) {
+            // Where each shell was in the keyframe
+            for (std::size_t i = begin; i < end; ++i) {
+                ProjectileHandle handle = store.handleAt(i);
+                bool inKeyframe = handle.index < keySlots_.size() &&
+                                  keySlots_[handle.index].keyframe == keyframeSerial_ &&
+                                  keySlots_[handle.index].generation == handle.generation;
+                keyIndex_[i] = inKeyframe ? keySlots_[handle.index].dense : NOT_IN_KEYFRAME;
+            }
+            std::fill(outOfRange_.begin() + begin, outOfRange_.begin() + end, 0);
+            for (int field = 0; field < QUANTIZED_FIELDS; ++field) {
+                quantizeField(values[field], keyValues[field], scales[field], keyIndex_.data(),
+                              quantized_[field].data(), outOfRange_.data(), begin, end);
+            }
+        });
+
+        // New shells, and shells that moved too far, are stored whole
+        std::size_t fullCount = 0;
+        std::size_t newCount = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            bool inKeyframe = keyIndex_[i] != NOT_IN_KEYFRAME;
+            if (inKeyframe && !outOfRange_[i]) {
+                continue;
+            }
+            keyIndex_[i] = STORED_WHOLE + static_cast<std::uint32_t>(fullCount);
+            for (auto& field : quantized_) {
+                field[i] = 0;
+            }
+            full_[fullCount] = FullShell{store.posX()[i], store.posY()[i], store.velX()[i], store.velY()[i],
+                                         store.radius()[i], store.timeAlive()[i], store.handleAt(i), 0};
+            if (!inKeyframe) {
+                wholeIndex_[newCount++] = static_cast<std::uint32_t>(fullCount);
+            }
+            ++fullCount;
+        }
+        if (newCount > 0) {
+            collectDueSteps(state);
+            for (std::size_t j = 0; j < newCount; ++j) {
+                FullShell& shell = full_[wholeIndex_[j]];
+                shell.due = due_[store.find(shell.handle)];
+            }
+        }
+        return fullCount;
+    }
+
+    // The keyframe columns deltas refer to, in ProjectileStore::writeColumns order
+    struct KeyframeColumns {
+        const float* posX;
+        const float* posY;
+        const float* velX;
+        const float* velY;
+        const float* radius;
+        const float* timeAlive;
+        const unsigned char* handles; // the store's handle image
+        const unsigned char* timers; // the wheel's image
+    };
+
+    KeyframeColumns keyframeColumns(const Frame& key) const {
+        const unsigned char* record = ring_.data() + key.offset;
+        RecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        const unsigned char* column = record + sizeof(header);
+        const unsigned char* starts[6];
+        for (std::size_t k = 0; k < columnSizes_.size(); ++k) {
+            if (k < 6) {
+                starts[k] = column;
+            }
+            column += padded(header.count * columnSizes_[k]);
+        }
+        return KeyframeColumns{reinterpret_cast<const float*>(starts[0]), reinterpret_cast<const float*>(starts[1]),
+                               reinterpret_cast<const float*>(starts[2]), reinterpret_cast<const float*>(starts[3]),
+                               reinterpret_cast<const float*>(starts[4]), reinterpret_cast<const float*>(starts[5]),
+                               column, column + padded(header.handleBytes)};
+    }
+
+    static void restoreHeader(const RecordHeader& header, const SimulationState& state) {
+        state.clock.restore(header.steps, header.simulatedTime, header.accumulator);
+        state.cannonAngle = header.cannonAngle;
+        state.cannonPower = header.cannonPower;
+        state.collisions = header.collisions != 0;
+    }
+
+    void restoreKeyframe(const Frame& frame, const SimulationState& state, JobSystem& jobs) const {
+        const unsigned char* record = ring_.data() + frame.offset;
+        RecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        restoreHeader(header, state);
+        KeyframeColumns columns = keyframeColumns(frame);
+        const unsigned char* column = record + sizeof(header);
+        state.projectiles.assignColumns(header.count, [&](std::size_t k) {
+            const unsigned char* start = column;
+            column += padded(header.count * columnSizes_[k]);
+            return start;
+        }, columns.handles, [&jobs](void* to, const void* from, std::size_t bytes) { copy(jobs, to, from, bytes); });
+        state.lifetimeTimers.loadImage(columns.timers);
+    }
+
+    void restoreDelta(const Frame& frame, const Frame& key, const SimulationState& state, JobSystem& jobs) {
+        const unsigned char* record = ring_.data() + frame.offset;
+        RecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        restoreHeader(header, state);
+        std::size_t count = header.count;
+        const unsigned char* in = record + sizeof(header);
+        const std::uint32_t* keyIndex = reinterpret_cast<const std::uint32_t*>(in);
+        in += padded(count * sizeof(std::uint32_t));
+        const std::int16_t* quantized[QUANTIZED_FIELDS];
+        for (auto& field : quantized) {
+            field = reinterpret_cast<const std::int16_t*>(in);
+            in += padded(count * sizeof(std::int16_t));
+        }
+        const FullShell* const fullShells = reinterpret_cast<const FullShell*>(in);
+
+        KeyframeColumns columns = keyframeColumns(key);
+        ProjectileStore& store = state.projectiles;
+        store.reset(count, [&](std::size_t i) {
+            std::uint32_t k = keyIndex[i];
+            return k >= STORED_WHOLE ? fullShells[k - STORED_WHOLE].handle
+                                     : ProjectileStore::savedHandleAt(columns.handles, k);
+        });
+        ProjectileSpan span = store.span();
+        float* radius = store.radiusColumn();
+        float* const fields[QUANTIZED_FIELDS] = {span.posX, span.posY, span.velX, span.velY, span.timeAlive};
+        const float* keyValues[QUANTIZED_FIELDS] = {columns.posX, columns.posY, columns.velX, columns.velY,
+                                                    columns.timeAlive};
+        const float scales[QUANTIZED_FIELDS] = {POSITION_SCALE, POSITION_SCALE, VELOCITY_SCALE, VELOCITY_SCALE,
+                                                AGE_SCALE};
+        // Straight into the store's columns, a column at a time within each
+        // chunk like encodeDeltas; then the chunk's shells stored whole, and
+        // what is derived from the positions
+        jobs.parallelFor(0, count, REWIND_GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (int field = 0; field < QUANTIZED_FIELDS; ++field) {
+                restoreField(keyValues[field], quantized[field], 1.0f / scales[field], keyIndex, fields[field],
+                             begin, end);
+            }
+            restoreField(columns.radius, nullptr, 0.0f, keyIndex, radius, begin, end);
+            for (std::size_t i = begin; i < end; ++i) {
+                if (keyIndex[i] >= STORED_WHOLE) {
+                    const FullShell& full = fullShells[keyIndex[i] - STORED_WHOLE];
+                    span.posX[i] = full.posX;
+                    span.posY[i] = full.posY;
+                    span.velX[i] = full.velX;
+                    span.velY[i] = full.velY;
+                    radius[i] = full.radius;
+                    span.timeAlive[i] = full.timeAlive;
+                }
+            }
+            std::memset(span.active + begin, 1, end - begin);
+            store.savePreviousPositions(begin, end);
+#if CANNON_FIXED_POINT
+            store.refreshFixedColumns(begin, end);
+#endif
+        });
+
+        // The keyframe's timers, less those that fired since, plus those of the
+        // shells fired since
+        TimingWheel<ProjectileHandle>& timers = state.lifetimeTimers;
+        timers.loadImage(columns.timers);
+        timers.advanceTo(header.steps, [](ProjectileHandle) {});
+        for (std::size_t j = 0; j < header.fullCount; ++j) {
+            const FullShell& shell = fullShells[j];
+            if (shell.due != 0) {
+                timers.schedule(shell.due, shell.handle);
+            }
+        }
+    }
+
+    // True if [offset, offset + bytes) overlaps a stored frame
+    bool overlapsHistory(std::size_t offset, std::size_t bytes) const {
+        if (frames() == 0) {
+            return false;
+        }
+        std::size_t end = offset + bytes;
+        if (head_ < tail_) {
+            return offset < tail_ && head_ < end;
+        }
+        return offset < tail_ || head_ < end; // history wraps: [head_, size) and [0, tail_)
+    }
+
+    // Finds room for a record at the tail, evicting the oldest frames (and the
+    // deltas of an evicted keyframe) until it fits
+    bool allocate(std::size_t bytes, std::size_t& offset) {
+        bytes = (bytes + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+        if (bytes > ring_.size()) {
+            return false;
+        }
+        offset = frames() == 0 ? 0 : tail_;
+        if (offset + bytes > ring_.size()) {
+            offset = 0;
+        }
+        while (frames() == MAX_FRAMES || overlapsHistory(offset, bytes)) {
+            evictOldest();
+        }
+        if (frames() == 0) {
+            head_ = offset;
+        }
+        return true;
+    }
+
+    void evictOldest() {
+        bool evictedKeyframe = entry(oldest_).keyframe == oldest_;
+        ++oldest_;
+        while (evictedKeyframe && oldest_ < next_ && entry(oldest_).keyframe != oldest_) {
+            ++oldest_;
+        }
+        head_ = oldest_ < next_ ? entry(oldest_).offset : tail_;
+    }
+
+    AlignedArray<unsigned char> ring_;
+    std::vector<Frame> frames_;
+    std::vector<std::size_t> columnSizes_;
+    std::uint64_t oldest_; // sequence numbers of the oldest frame and the next one
+    std::uint64_t next_;
+    std::size_t head_; // ring offsets of the oldest frame and just past the newest
+    std::size_t tail_;
+    std::uint64_t keyframe_; // sequence number of the keyframe new deltas refer to
+    std::uint64_t keyframeSerial_; // keyframes ever captured; never reused, unlike sequence numbers
+    std::uint32_t sinceKeyframe_;
+    bool forceKeyframe_;
+
+    // Scratch, sized to the largest world seen
+    std::vector<KeyframeSlot> keySlots_;
+    std::vector<std::uint64_t> due_;
+    std::vector<std::uint32_t> keyIndex_;
+    std::vector<std::int16_t> quantized_[QUANTIZED_FIELDS];
+    std::vector<FullShell> full_;
+    std::vector<std::uint32_t> wholeIndex_; // entries of full_ fired since the keyframe
+    std::vector<std::uint8_t> outOfRange_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// Fixed-timestep simulation clock. Frame time is banked in an accumulator and
+// paid out in whole steps of stepSeconds(), at most maxStepsPerFrame() per
+// frame; whatever is left over becomes the render interpolation factor.
+class SimulationClock {
+public:
+    SimulationClock(double stepsPerSecond, int maxStepsPerFrame)
+        : stepSeconds_(1.0 / stepsPerSecond), maxStepsPerFrame_(maxStepsPerFrame),
+          accumulator_(0.0), simulatedTime_(0.0), steps_(0) {}
+
+    double stepSeconds() const { return stepSeconds_; }
+    int maxStepsPerFrame() const { return maxStepsPerFrame_; }
+    double simulatedTime() const { return simulatedTime_; }
+    unsigned long long steps() const { return steps_; }
+    double accumulator() const { return accumulator_; }
+
+    void setRate(double stepsPerSecond) { stepSeconds_ = 1.0 / stepsPerSecond; }
+    void setMaxStepsPerFrame(int maxSteps) { maxStepsPerFrame_ = maxSteps; }
+
+    // Banks frameSeconds and returns how many fixed steps to run this frame.
+    // Time beyond the step cap is dropped so a long hitch cannot snowball into
+    // ever longer frames; the simulation just runs slow for that frame.
+    int advance(double frameSeconds) {
+        if (frameSeconds > 0.0) {
+            accumulator_ += frameSeconds;
+        }
+        int count = 0;
+        while (accumulator_ >= stepSeconds_ && count < maxStepsPerFrame_) {
+            accumulator_ -= stepSeconds_;
+            ++count;
+        }
+        if (count == maxStepsPerFrame_ && accumulator_ >= stepSeconds_) {
+            accumulator_ = 0.0;
+        }
+        simulatedTime_ += count * stepSeconds_;
+        steps_ += count;
+        return count;
+    }
+
+    // Puts the clock back to a saved point, e.g. a replay keyframe
+    void restore(unsigned long long steps, double simulatedTime, double accumulator) {
+        steps_ = steps;
+        simulatedTime_ = simulatedTime;
+        accumulator_ = accumulator;
+    }
+
+    // Fraction of a step between the previous and current simulated states
+    float alpha() const { return static_cast<float>(accumulator_ / stepSeconds_); }
+
+private:
+    double stepSeconds_;
+    int maxStepsPerFrame_;
+    double accumulator_;
+    double simulatedTime_;
+    unsigned long long steps_;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "projectile_store.h"
+#include "simulation_clock.h"
+#include "timing_wheel.h"
+#include <glm/glm.hpp>
+
+// The stepped simulation's world, as references to the objects that hold it;
+// what replay keyframes and world snapshots save and restore
+struct SimulationState {
+    ProjectileStore& projectiles;
+    TimingWheel<ProjectileHandle>& lifetimeTimers;
+    SimulationClock& clock;
+    float& cannonAngle;
+    float& cannonPower;
+    glm::vec2& cannonPosition;
+    bool& collisions;
+};
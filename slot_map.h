@@ -0,0 +1,268 @@
+#pragma once
+
+#include "aligned_array.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Stable reference into a SlotMap. The generation changes every time a slot is
+// reused, so a handle to an erased element never resolves to its successor.
+// A default-constructed handle (generation 0) is null.
+template <typename Tag>
+struct SlotHandle {
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    SlotHandle() : index(0), generation(0) {}
+    SlotHandle(std::uint32_t i, std::uint32_t g) : index(i), generation(g) {}
+
+    bool isNull() const { return generation == 0; }
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Generational slot map over densely packed elements. It stores no values itself:
+// owners keep their data in dense arrays indexed 0..size()-1 and mirror every
+// insert (append) and eraseAt (move last into the hole) on those arrays.
+// insert, find and eraseAt are all O(1); freed slots are recycled through an
+// intrusive free list.
+template <typename Tag>
+class SlotMap {
+public:
+    typedef SlotHandle<Tag> Handle;
+
+    static const std::uint32_t npos = 0xFFFFFFFFu;
+
+    SlotMap() : freeHead_(npos) {}
+
+    std::size_t size() const { return denseToSlot_.size(); }
+    // Every handle's index is below this
+    std::size_t slotCount() const { return slots_.size(); }
+
+    void reserve(std::size_t capacity) {
+        slots_.reserve(capacity);
+        denseToSlot_.reserve(capacity);
+    }
+
+    // Allocates a handle for a new element at dense index size()
+    Handle insert() {
+        std::uint32_t slotIndex;
+        if (freeHead_ != npos) {
+            slotIndex = freeHead_;
+            freeHead_ = slots_[slotIndex].dense;
+        } else {
+            slotIndex = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back(Slot{0, 1});
+        }
+        Slot& slot = slots_[slotIndex];
+        slot.dense = static_cast<std::uint32_t>(denseToSlot_.size());
+        denseToSlot_.push_back(slotIndex);
+        return Handle(slotIndex, slot.generation);
+    }
+
+    // Dense index of a live handle, or npos if it is null or stale
+    std::uint32_t find(Handle handle) const {
+        if (handle.index >= slots_.size()) {
+            return npos;
+        }
+        const Slot& slot = slots_[handle.index];
+        if (slot.generation != handle.generation) {
+            return npos;
+        }
+        return slot.dense;
+    }
+
+    bool contains(Handle handle) const { return find(handle) != npos; }
+
+    Handle handleAt(std::size_t dense) const {
+        std::uint32_t slotIndex = denseToSlot_[dense];
+        return Handle(slotIndex, slots_[slotIndex].generation);
+    }
+
+    // Frees the element at `dense`; the last element takes its dense index
+    void eraseAt(std::size_t dense) {
+        std::uint32_t slotIndex = denseToSlot_[dense];
+        std::uint32_t lastSlot = denseToSlot_.back();
+        denseToSlot_[dense] = lastSlot;
+        slots_[lastSlot].dense = static_cast<std::uint32_t>(dense);
+        denseToSlot_.pop_back();
+        release(slotIndex);
+    }
+
+    // Replaces the contents with `count` elements, element i holding the handle
+    // handleAt(i) returns (such as a saved world's), in a few sequential passes
+    // over the slots instead of an insert() each. Slots left free keep
+    // generations none of their handles had, and slots live until now move on
+    // one, so no handle erased before or after the handles were saved resolves
+    // to one of them. If the map already holds exactly those handles in that
+    // order it is left alone, free list included, after one read-only pass.
+    template <typename HandleAt>
+    void assign(std::size_t count, HandleAt handleAt) {
+        if (holds(count, handleAt)) {
+            return;
+        }
+        for (std::uint32_t slotIndex : denseToSlot_) {
+            if (++slots_[slotIndex].generation == 0) {
+                slots_[slotIndex].generation = 1;
+            }
+        }
+        for (Slot& slot : slots_) {
+            slot.dense = npos;
+        }
+        denseToSlot_.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            Handle handle = handleAt(i);
+            if (handle.index >= slots_.size()) {
+                slots_.resize(handle.index + 1, Slot{0, 1});
+            }
+            slots_[handle.index] = Slot{static_cast<std::uint32_t>(i), handle.generation};
+            denseToSlot_[i] = handle.index;
+        }
+        // Every other slot is free; lowest index first, like a fresh map
+        freeHead_ = npos;
+        for (std::size_t slotIndex = slots_.size(); slotIndex-- > 0;) {
+            Slot& slot = slots_[slotIndex];
+            if (slot.dense == npos) {
+                slot.dense = freeHead_;
+                freeHead_ = static_cast<std::uint32_t>(slotIndex);
+            }
+        }
+    }
+
+    // Whether element i has handle handleAt(i) for every i below size() == count
+    template <typename HandleAt>
+    bool holds(std::size_t count, HandleAt handleAt) const {
+        if (count != size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            if (handleAt(i) != this->handleAt(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Bytes saveImage writes: both arrays and the free list, so loadImage can
+    // put the map back exactly, one copy per array
+    std::size_t imageBytes() const {
+        return sizeof(ImageHeader) + denseToSlot_.size() * sizeof(std::uint32_t) + slots_.size() * sizeof(Slot);
+    }
+
+    void saveImage(unsigned char* out) const {
+        ImageHeader header{denseToSlot_.size(), slots_.size(), freeHead_, 0};
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        if (!denseToSlot_.empty()) {
+            std::memcpy(out, denseToSlot_.data(), denseToSlot_.size() * sizeof(std::uint32_t));
+        }
+        out += denseToSlot_.size() * sizeof(std::uint32_t);
+        if (!slots_.empty()) {
+            std::memcpy(out, slots_.data(), slots_.size() * sizeof(Slot));
+        }
+    }
+
+    // Replaces the map with one saveImage wrote. Handles then resolve as they
+    // did when it was saved; ones issued since may be issued again.
+    void loadImage(const unsigned char* in) {
+        ImageHeader header;
+        std::memcpy(&header, in, sizeof(header));
+        const std::uint32_t* denseToSlot = reinterpret_cast<const std::uint32_t*>(in + sizeof(header));
+        const Slot* slots = reinterpret_cast<const Slot*>(denseToSlot + header.size);
+        denseToSlot_.assign(denseToSlot, denseToSlot + header.size);
+        slots_.assign(slots, slots + header.slots);
+        freeHead_ = header.freeHead;
+    }
+
+    // The same, except that the map takes over the image's arrays and works
+    // on them in place until it outgrows them (see borrowed), so `image`
+    // must stay valid and writable until then
+    void adoptImage(unsigned char* image) {
+        ImageHeader header;
+        std::memcpy(&header, image, sizeof(header));
+        std::uint32_t* denseToSlot = reinterpret_cast<std::uint32_t*>(image + sizeof(header));
+        denseToSlot_.adopt(denseToSlot, header.size);
+        slots_.adopt(reinterpret_cast<Slot*>(denseToSlot + header.size), header.slots);
+        freeHead_ = header.freeHead;
+    }
+
+    // Whether the map still works on part of an adopted image
+    bool borrowed() const { return denseToSlot_.borrowed() || slots_.borrowed(); }
+
+    // Whether the `bytes` at `image` hold a saveImage image of a map with `size`
+    // elements that loadImage can take as it is (one read from a file, say):
+    // every index in range, live slots and dense indices pointing at each
+    // other, and a free list of free slots that ends
+    static bool validImage(const unsigned char* image, std::size_t bytes, std::size_t size) {
+        ImageHeader header;
+        if (bytes < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, image, sizeof(header));
+        if (header.size != size || header.slots < header.size || header.slots > npos ||
+            (bytes - sizeof(header)) / sizeof(Slot) < header.slots ||
+            bytes - sizeof(header) - header.slots * sizeof(Slot) < header.size * sizeof(std::uint32_t)) {
+            return false;
+        }
+        const std::uint32_t* denseToSlot = reinterpret_cast<const std::uint32_t*>(image + sizeof(header));
+        const Slot* slots = reinterpret_cast<const Slot*>(denseToSlot + header.size);
+        for (std::size_t i = 0; i < header.size; ++i) {
+            if (denseToSlot[i] >= header.slots || slots[denseToSlot[i]].dense != i) {
+                return false;
+            }
+        }
+        std::size_t freeSlots = 0;
+        for (std::uint32_t slot = header.freeHead; slot != npos; slot = slots[slot].dense) {
+            if (slot >= header.slots || ++freeSlots > header.slots - header.size ||
+                (slots[slot].dense < header.size && denseToSlot[slots[slot].dense] == slot)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Handle of the element at `dense` in an image saveImage wrote
+    static Handle imageHandleAt(const unsigned char* image, std::size_t dense) {
+        ImageHeader header;
+        std::memcpy(&header, image, sizeof(header));
+        const std::uint32_t* denseToSlot = reinterpret_cast<const std::uint32_t*>(image + sizeof(header));
+        const Slot* slots = reinterpret_cast<const Slot*>(denseToSlot + header.size);
+        std::uint32_t slotIndex = denseToSlot[dense];
+        return Handle(slotIndex, slots[slotIndex].generation);
+    }
+
+    void clear() {
+        for (std::uint32_t slotIndex : denseToSlot_) {
+            release(slotIndex);
+        }
+        denseToSlot_.clear();
+    }
+
+private:
+    struct Slot {
+        std::uint32_t dense; // dense index while live, next free slot while free
+        std::uint32_t generation;
+    };
+
+    struct ImageHeader {
+        std::uint64_t size;
+        std::uint64_t slots;
+        std::uint32_t freeHead;
+        std::uint32_t reserved;
+    };
+
+    void release(std::uint32_t slotIndex) {
+        Slot& slot = slots_[slotIndex];
+        if (++slot.generation == 0) {
+            slot.generation = 1;
+        }
+        // A freed slot is told apart from a live one by its stale generation;
+        // the dense field becomes the free-list link
+        slot.dense = freeHead_;
+        freeHead_ = slotIndex;
+    }
+
+    AlignedArray<Slot> slots_;
+    AlignedArray<std::uint32_t> denseToSlot_;
+    std::uint32_t freeHead_;
+};
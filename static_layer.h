@@ -0,0 +1,92 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <iostream>
+
+// Offscreen copy of the parts of the scene that do not change between frames.
+// The layer is rendered into a framebuffer-sized texture once and blitted to
+// the default framebuffer every frame; it is only redrawn after invalidate()
+// (window resize, scene geometry change) or when the requested size changes.
+class StaticLayerCache {
+public:
+    StaticLayerCache() : framebuffer_(0), texture_(0), width_(0), height_(0), dirty_(true) {}
+    ~StaticLayerCache() { destroy(); }
+
+    StaticLayerCache(const StaticLayerCache&) = delete;
+    StaticLayerCache& operator=(const StaticLayerCache&) = delete;
+
+    bool ready() const { return framebuffer_ != 0; }
+
+    // Needs a current GL 3.0+ context
+    bool init() {
+        glGenFramebuffers(1, &framebuffer_);
+        glGenTextures(1, &texture_);
+        dirty_ = true;
+        return framebuffer_ != 0 && texture_ != 0;
+    }
+
+    void destroy() {
+        if (texture_) glDeleteTextures(1, &texture_);
+        if (framebuffer_) glDeleteFramebuffers(1, &framebuffer_);
+        framebuffer_ = texture_ = 0;
+        width_ = height_ = 0;
+    }
+
+    void invalidate() { dirty_ = true; }
+
+    // Copies the cached layer over the whole default framebuffer, first calling
+    // renderStatic() into the cache if it is stale. Returns false (and draws
+    // nothing) if the cache cannot be used, so the caller can draw directly.
+    template <typename RenderStatic>
+    bool draw(int width, int height, RenderStatic renderStatic) {
+        if (!ready() || width <= 0 || height <= 0) {
+            return false;
+        }
+        if (dirty_ || width != width_ || height != height_) {
+            if (!rebuild(width, height, renderStatic)) {
+                return false;
+            }
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+private:
+    template <typename RenderStatic>
+    bool rebuild(int width, int height, RenderStatic& renderStatic) {
+        if (width != width_ || height != height_) {
+            glBindTexture(GL_TEXTURE_2D, texture_);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Static layer framebuffer is incomplete" << std::endl;
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                destroy();
+                return false;
+            }
+            width_ = width;
+            height_ = height;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+        renderStatic();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        dirty_ = false;
+        return true;
+    }
+
+    GLuint framebuffer_;
+    GLuint texture_;
+    int width_;
+    int height_;
+    bool dirty_;
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "aligned_array.h"
+#include "slot_map.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Hierarchical timing wheel over integer ticks (simulation steps). Level k has
+// 64 slots of 64^k ticks each; a timer sits in the lowest level whose span
+// covers the ticks left until it is due and moves down a level each time the
+// wheel below it wraps, so it is touched at most LEVELS times between schedule
+// and expiry. Schedule and cancel are O(1); advancing fires whole slots at once.
+// Timers further out than the top level can reach are re-filed each time the
+// top level comes round to their slot.
+//
+// Timers are nodes in one pool linked into per-slot lists, recycled through a
+// free list, so a steady state allocates nothing. Handles carry a generation,
+// so cancelling a timer that already fired is a no-op.
+template <typename Payload>
+class TimingWheel {
+public:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const std::uint32_t SLOTS = 1u << SLOT_BITS;
+
+    typedef SlotHandle<TimingWheel> TimerHandle;
+
+    TimingWheel() : now_(0), pending_(0), freeHead_(npos) {
+        for (std::uint32_t& head : heads_) {
+            head = npos;
+        }
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    unsigned long long now() const { return now_; }
+    std::size_t size() const { return pending_; }
+
+    // Fires `payload` when the wheel reaches `tick`; ticks already reached fire on the next one
+    TimerHandle schedule(unsigned long long tick, const Payload& payload) {
+        std::uint32_t index;
+        if (freeHead_ != npos) {
+            index = freeHead_;
+            freeHead_ = nodes_[index].next;
+        } else {
+            index = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.push_back(Node());
+            if (backing_ && !nodes_.borrowed()) {
+                backing_.reset(); // the nodes have moved out of the adopted image
+            }
+        }
+        Node& node = nodes_[index];
+        node.payload = payload;
+        node.due = tick > now_ ? tick : now_ + 1;
+        file(index);
+        ++pending_;
+        return TimerHandle(index, node.generation);
+    }
+
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerHandle handle) {
+        if (handle.index >= nodes_.size()) {
+            return false;
+        }
+        Node& node = nodes_[handle.index];
+        if (node.generation != handle.generation || node.bucket == npos) {
+            return false;
+        }
+        unlink(handle.index);
+        release(handle.index);
+        return true;
+    }
+
+    // Steps the wheel tick by tick up to `tick`, calling fire(payload) for each
+    // timer as it comes due. fire may schedule or cancel timers.
+    // Returns the number fired.
+    template <typename Fire>
+    std::size_t advanceTo(unsigned long long tick, Fire fire) {
+        std::size_t fired = 0;
+        while (now_ < tick) {
+            ++now_;
+            // Refile the slots that just came round, top level first, so their
+            // timers can drop all the way to level 0 in one tick
+            for (int level = LEVELS - 1; level > 0; --level) {
+                if ((now_ & ((1ull << (level * SLOT_BITS)) - 1)) == 0) {
+                    std::uint32_t index = detach(bucketAt(level, now_));
+                    while (index != npos) {
+                        std::uint32_t next = nodes_[index].next;
+                        file(index);
+                        index = next;
+                    }
+                }
+            }
+
+            // One at a time, so fire can cancel a timer due on this same tick
+            std::uint32_t bucket = bucketAt(0, now_);
+            while (heads_[bucket] != npos) {
+                std::uint32_t index = heads_[bucket];
+                Payload payload = nodes_[index].payload;
+                unlink(index);
+                release(index);
+                fire(payload);
+                ++fired;
+            }
+        }
+        return fired;
+    }
+
+    // Calls visit(due, payload) for every pending timer, in no particular order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const Node& node : nodes_) {
+            if (node.bucket != npos) {
+                visit(node.due, node.payload);
+            }
+        }
+    }
+
+    // Drops every timer and restarts the wheel at `tick`; outstanding handles
+    // must not be used afterwards
+    void reset(unsigned long long tick) {
+        nodes_.clear();
+        for (std::uint32_t& head : heads_) {
+            head = npos;
+        }
+        freeHead_ = npos;
+        pending_ = 0;
+        now_ = tick;
+    }
+
+    // Bytes saveImage writes: the whole wheel, pending timers, free nodes and
+    // handles included, so a saved wheel comes back with one copy instead of
+    // a schedule() per timer
+    std::size_t imageBytes() const { return sizeof(ImageHeader) + sizeof(heads_) + nodes_.size() * sizeof(Node); }
+
+    void saveImage(unsigned char* out) const {
+        static_assert(std::is_trivially_copyable<Node>::value, "timer nodes are saved as bytes");
+        ImageHeader header{now_, pending_, nodes_.size(), freeHead_, 0};
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), heads_, sizeof(heads_));
+        if (!nodes_.empty()) {
+            std::memcpy(out + sizeof(header) + sizeof(heads_), nodes_.data(), nodes_.size() * sizeof(Node));
+        }
+    }
+
+    // Replaces the wheel with one saveImage wrote; outstanding handles then
+    // refer to the saved wheel's timers
+    void loadImage(const unsigned char* in) {
+        ImageHeader header;
+        std::memcpy(&header, in, sizeof(header));
+        std::memcpy(heads_, in + sizeof(header), sizeof(heads_));
+        const Node* nodes = reinterpret_cast<const Node*>(in + sizeof(header) + sizeof(heads_));
+        nodes_.assign(nodes, nodes + header.nodes);
+        if (backing_ && !nodes_.borrowed()) {
+            backing_.reset();
+        }
+        now_ = header.now;
+        pending_ = header.pending;
+        freeHead_ = header.freeHead;
+    }
+
+    // The same, except that the wheel works on the image's nodes in place until
+    // it outgrows them, keeping `backing` (whatever owns the image) alive
+    // until then
+    void adoptImage(unsigned char* image, std::shared_ptr<void> backing) {
+        ImageHeader header;
+        std::memcpy(&header, image, sizeof(header));
+        std::memcpy(heads_, image + sizeof(header), sizeof(heads_));
+        nodes_.adopt(reinterpret_cast<Node*>(image + sizeof(header) + sizeof(heads_)), header.nodes);
+        backing_ = std::move(backing);
+        now_ = header.now;
+        pending_ = header.pending;
+        freeHead_ = header.freeHead;
+    }
+
+    // Whether the `bytes` at `image` hold a saveImage image that loadImage can
+    // take as it is (one read from a file, say): every index in range, each
+    // slot's list linked both ways from its head, and a free list that ends
+    static bool validImage(const unsigned char* image, std::size_t bytes) {
+        ImageHeader header;
+        if (bytes < sizeof(header) + sizeof(heads_)) {
+            return false;
+        }
+        std::memcpy(&header, image, sizeof(header));
+        if (header.nodes >= npos || (bytes - sizeof(header) - sizeof(heads_)) / sizeof(Node) < header.nodes ||
+            header.pending > header.nodes) {
+            return false;
+        }
+        const std::uint32_t* heads = reinterpret_cast<const std::uint32_t*>(image + sizeof(header));
+        const Node* nodes = reinterpret_cast<const Node*>(image + sizeof(header) + sizeof(heads_));
+        for (std::uint32_t bucket = 0; bucket < LEVELS * SLOTS; ++bucket) {
+            if (heads[bucket] != npos && (heads[bucket] >= header.nodes || nodes[heads[bucket]].bucket != bucket ||
+                                          nodes[heads[bucket]].prev != npos)) {
+                return false;
+            }
+        }
+        std::size_t pending = 0;
+        for (std::uint32_t index = 0; index < header.nodes; ++index) {
+            const Node& node = nodes[index];
+            if (node.bucket == npos) {
+                continue;
+            }
+            if (node.bucket >= LEVELS * SLOTS ||
+                (node.prev == npos ? heads[node.bucket] != index
+                                   : node.prev >= header.nodes || nodes[node.prev].next != index ||
+                                         nodes[node.prev].bucket != node.bucket) ||
+                (node.next != npos && (node.next >= header.nodes || nodes[node.next].prev != index ||
+                                       nodes[node.next].bucket != node.bucket))) {
+                return false;
+            }
+            ++pending;
+        }
+        std::size_t freeNodes = 0;
+        for (std::uint32_t index = header.freeHead; index != npos; index = nodes[index].next) {
+            if (index >= header.nodes || nodes[index].bucket != npos || ++freeNodes > header.nodes - pending) {
+                return false;
+            }
+        }
+        return pending == header.pending;
+    }
+
+private:
+    static const std::uint32_t npos = 0xFFFFFFFFu;
+
+    struct ImageHeader {
+        unsigned long long now;
+        std::size_t pending;
+        std::size_t nodes;
+        std::uint32_t freeHead;
+        std::uint32_t reserved;
+    };
+
+    struct Node {
+        Payload payload;
+        unsigned long long due = 0;
+        std::uint32_t prev = npos;
+        std::uint32_t next = npos; // free-list link while free
+        std::uint32_t bucket = npos; // npos while free or being refiled
+        std::uint32_t generation = 1;
+    };
+
+    static std::uint32_t bucketAt(int level, unsigned long long tick) {
+        return static_cast<std::uint32_t>(level) * SLOTS +
+               static_cast<std::uint32_t>((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    // Links a node into the slot for its due tick, relative to now_
+    void file(std::uint32_t index) {
+        Node& node = nodes_[index];
+        unsigned long long delta = node.due - now_;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (1ull << ((level + 1) * SLOT_BITS))) {
+            ++level;
+        }
+        std::uint32_t bucket = bucketAt(level, node.due);
+        node.bucket = bucket;
+        node.prev = npos;
+        node.next = heads_[bucket];
+        if (node.next != npos) {
+            nodes_[node.next].prev = index;
+        }
+        heads_[bucket] = index;
+    }
+
+    void unlink(std::uint32_t index) {
+        Node& node = nodes_[index];
+        if (node.prev != npos) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            heads_[node.bucket] = node.next;
+        }
+        if (node.next != npos) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.bucket = npos;
+    }
+
+    // Empties a slot and returns its list; the nodes keep their next links
+    std::uint32_t detach(std::uint32_t bucket) {
+        std::uint32_t head = heads_[bucket];
+        heads_[bucket] = npos;
+        for (std::uint32_t index = head; index != npos; index = nodes_[index].next) {
+            nodes_[index].bucket = npos;
+        }
+        return head;
+    }
+
+    void release(std::uint32_t index) {
+        Node& node = nodes_[index];
+        node.bucket = npos;
+        if (++node.generation == 0) {
+            node.generation = 1;
+        }
+        node.next = freeHead_;
+        freeHead_ = index;
+        --pending_;
+    }
+
+    unsigned long long now_;
+    std::size_t pending_;
+    std::uint32_t freeHead_;
+    std::uint32_t heads_[LEVELS * SLOTS];
+    AlignedArray<Node> nodes_;
+    std::shared_ptr<void> backing_; // owner of an adopted image's nodes (adoptImage)
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Begin/end event recorder that writes Chrome trace-event JSON (chrome://tracing,
+// Perfetto). Each thread records into its own fixed-size ring with no locks or
+// allocation; the flushing thread drains the rings. Recording is off until
+// setEnabled(true), and when off a TRACE_SCOPE costs one relaxed load.
+//
+// Event names are stored by pointer and must outlive the tracer (string literals).
+// If a thread's ring fills before the next flush, further events from that
+// thread are dropped and counted rather than blocking the thread.
+class Tracer {
+public:
+    static const std::size_t BUFFER_EVENTS = 1 << 16;
+
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    void begin(const char* name) { record(name, 'B'); }
+    void end(const char* name) { record(name, 'E'); }
+
+    // Label shown for the calling thread in the viewer. Does not allocate the
+    // thread's buffer; that happens on its first recorded event.
+    void setThreadName(const std::string& name) {
+        ThreadState& state = threadState();
+        if (state.buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            state.buffer->name = name;
+        } else {
+            state.name = name;
+        }
+    }
+
+    // Moves every event recorded so far into a trace-event JSON document.
+    // Events recorded while flushing go to the next flush.
+    void flush(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n" << std::fixed << std::setprecision(3);
+        bool first = true;
+        for (auto& buffer : buffers_) {
+            out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << buffer->id << ", \"args\": {\"name\": ";
+            writeString(out, buffer->name);
+            out << "}}";
+            first = false;
+
+            std::size_t head = buffer->head.load(std::memory_order_acquire);
+            std::size_t tail = buffer->tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail) {
+                const TraceEvent& event = buffer->events[tail % BUFFER_EVENTS];
+                out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"" << event.phase
+                    << "\", \"ts\": " << event.nanoseconds / 1000.0 << ", \"pid\": 1, \"tid\": " << buffer->id << "}";
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+
+            std::uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped) {
+                std::cerr << "Trace buffer of " << buffer->name << " overflowed, dropped " << dropped
+                          << " events" << std::endl;
+            }
+        }
+        out << "\n]}\n" << std::defaultfloat;
+    }
+
+    bool flush(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Failed to open trace file " << path << std::endl;
+            return false;
+        }
+        flush(out);
+        return true;
+    }
+
+private:
+    // `text` as a JSON string literal: quotes, backslashes and control
+    // characters escaped
+    static void writeString(std::ostream& out, const std::string& text) {
+        static const char hex[] = "0123456789abcdef";
+        out << '"';
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (c < 0x20) {
+                out << "\\u00" << hex[c >> 4] << hex[c & 15];
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    struct TraceEvent {
+        const char* name;
+        std::uint64_t nanoseconds; // since the tracer was created
+        char phase;                // 'B' or 'E'
+    };
+
+    // Single-producer ring: the owning thread advances head, flush advances tail
+    struct ThreadBuffer {
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<std::size_t> head{0};
+        std::atomic<std::size_t> tail{0};
+        std::atomic<std::uint64_t> dropped{0};
+        unsigned id = 0;
+        std::string name;
+    };
+
+    Tracer() : enabled_(false), start_(std::chrono::steady_clock::now()) {}
+
+    void record(const char* name, char phase) {
+        std::uint64_t nanoseconds = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+        ThreadBuffer& buffer = local();
+        std::size_t head = buffer.head.load(std::memory_order_relaxed);
+        if (head - buffer.tail.load(std::memory_order_acquire) == BUFFER_EVENTS) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[head % BUFFER_EVENTS] = TraceEvent{name, nanoseconds, phase};
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    struct ThreadState {
+        ThreadBuffer* buffer = nullptr;
+        std::string name; // set before the buffer exists
+    };
+
+    static ThreadState& threadState() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    // Buffers are owned by the tracer so events survive the thread that wrote them
+    ThreadBuffer& local() {
+        ThreadState& state = threadState();
+        if (!state.buffer) {
+            std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+            created->events.reset(new TraceEvent[BUFFER_EVENTS]);
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            created->id = static_cast<unsigned>(buffers_.size());
+            created->name = state.name.empty() ? "thread " + std::to_string(created->id) : state.name;
+            state.buffer = created.get();
+            buffers_.push_back(std::move(created));
+        }
+        return *state.buffer;
+    }
+
+    std::atomic<bool> enabled_;
+    std::chrono::steady_clock::time_point start_;
+    std::mutex registryMutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records a begin event now and the matching end event when the scope exits
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(Tracer::instance().enabled() ? name : nullptr) {
+        if (name_) {
+            Tracer::instance().begin(name_);
+        }
+    }
+
+    ~TraceScope() {
+        if (name_) {
+            Tracer::instance().end(name_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "projectile_store.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// Trajectory file: every shell's state after every simulation step, for offline
+// analysis. Everything below is padded to TRAJECTORY_ALIGNMENT.
+//   TrajectoryFileHeader
+//   then blocks, each:
+//     TrajectoryBlockHeader
+//     step table: TRAJECTORY_BLOCK_STEPS TrajectoryStep entries, stepCount used
+//     columns of sampleCount values: id (u64, handle generation << 32 | slot
+//     index, so one shell's samples share an id), posX, posY, velX, velY,
+//     timeAlive (f32)
+//   A block's samples are grouped by step in step table order; a step with more
+//   samples than fit in one block continues in the next.
+// Fields are in host byte order; byteOrder lets a reader spot a foreign file.
+const char TRAJECTORY_MAGIC[4] = {'C', 'N', 'T', 'R'};
+const char TRAJECTORY_BLOCK_MAGIC[4] = {'B', 'L', 'C', 'K'};
+const std::uint32_t TRAJECTORY_VERSION = 1;
+const std::uint32_t TRAJECTORY_BYTE_ORDER = 0x01020304u;
+const std::size_t TRAJECTORY_ALIGNMENT = 4096;
+const std::size_t TRAJECTORY_FLOAT_COLUMNS = 5;
+const std::size_t TRAJECTORY_BLOCK_STEPS = 256;
+
+struct TrajectoryFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t columnCount; // id plus the float columns
+    double stepSeconds;
+};
+
+struct TrajectoryBlockHeader {
+    char magic[4];
+    std::uint32_t stepCount;
+    std::uint64_t sampleCount;
+    std::uint64_t blockBytes; // header included, so a reader can skip to the next block
+};
+
+struct TrajectoryStep {
+    std::uint64_t step;
+    std::uint32_t firstSample;
+    std::uint32_t sampleCount;
+};
+
+static_assert(TRAJECTORY_BLOCK_STEPS * sizeof(TrajectoryStep) % TRAJECTORY_ALIGNMENT == 0,
+              "the step table fills whole pages");
+
+inline std::size_t alignTrajectoryBytes(std::size_t bytes) {
+    return (bytes + TRAJECTORY_ALIGNMENT - 1) / TRAJECTORY_ALIGNMENT * TRAJECTORY_ALIGNMENT;
+}
+
+// Streams trajectories to a file without blocking the simulation. sample()
+// copies the store's columns into the block being filled; full blocks go
+// through a single-producer, single-consumer ring of BLOCKS preallocated blocks
+// to a writer thread, which writes each column with one large page-aligned
+// write. If the writer falls behind and every block is queued, sample() drops
+// the samples that do not fit and counts them rather than waiting for the disk,
+// unless the exporter was opened to wait (for runs with no frame deadline).
+class TrajectoryExporter {
+public:
+    static const std::size_t BLOCK_SAMPLES = 1 << 18;
+    static const std::size_t BLOCKS = 8;
+
+    TrajectoryExporter()
+        : fd_(-1), waitWhenFull_(false), head_(0), tail_(0), stop_(false), failed_(false), samples_(0),
+          droppedSamples_(0), bytesWritten_(0) {}
+    ~TrajectoryExporter() { close(); }
+
+    TrajectoryExporter(const TrajectoryExporter&) = delete;
+    TrajectoryExporter& operator=(const TrajectoryExporter&) = delete;
+
+    bool open(const std::string& path, double stepSeconds, bool waitWhenFull) {
+        close();
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            std::cerr << "Failed to open trajectory file " << path << std::endl;
+            return false;
+        }
+        for (std::unique_ptr<Block>& block : blocks_) {
+            if (!block) {
+                block.reset(new Block());
+            }
+            block->clear();
+        }
+        path_ = path;
+        waitWhenFull_ = waitWhenFull;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        stop_.store(false, std::memory_order_relaxed);
+        failed_.store(false, std::memory_order_relaxed);
+        samples_ = 0;
+        droppedSamples_ = 0;
+        bytesWritten_ = 0;
+
+        AlignedArray<unsigned char> header;
+        header.resize(TRAJECTORY_ALIGNMENT);
+        std::memset(header.data(), 0, TRAJECTORY_ALIGNMENT);
+        TrajectoryFileHeader fileHeader;
+        std::memset(&fileHeader, 0, sizeof(fileHeader));
+        std::memcpy(fileHeader.magic, TRAJECTORY_MAGIC, sizeof(fileHeader.magic));
+        fileHeader.version = TRAJECTORY_VERSION;
+        fileHeader.byteOrder = TRAJECTORY_BYTE_ORDER;
+        fileHeader.columnCount = 1 + TRAJECTORY_FLOAT_COLUMNS;
+        fileHeader.stepSeconds = stepSeconds;
+        std::memcpy(header.data(), &fileHeader, sizeof(fileHeader));
+        if (!writeAll(header.data(), TRAJECTORY_ALIGNMENT)) {
+            std::cerr << "Failed to write trajectory file " << path << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        bytesWritten_ = TRAJECTORY_ALIGNMENT;
+        writer_ = std::thread([this] { writerMain(); });
+        return true;
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Queues every shell's state after simulation step `step`
+    void sample(unsigned long long step, const ProjectileStore& store) {
+        if (!isOpen()) {
+            return;
+        }
+        std::size_t count = store.size();
+        std::size_t done = 0;
+        while (done < count) {
+            Block* block = fillingBlock();
+            if (!block) {
+                droppedSamples_ += count - done;
+                return;
+            }
+            std::size_t taken = std::min(BLOCK_SAMPLES - block->sampleCount, count - done);
+            std::size_t at = block->sampleCount;
+            std::memcpy(block->columns[0].data() + at, store.posX() + done, taken * sizeof(float));
+            std::memcpy(block->columns[1].data() + at, store.posY() + done, taken * sizeof(float));
+            std::memcpy(block->columns[2].data() + at, store.velX() + done, taken * sizeof(float));
+            std::memcpy(block->columns[3].data() + at, store.velY() + done, taken * sizeof(float));
+            std::memcpy(block->columns[4].data() + at, store.timeAlive() + done, taken * sizeof(float));
+            std::uint64_t* ids = block->ids.data() + at;
+            for (std::size_t i = 0; i < taken; ++i) {
+                ProjectileHandle handle = store.handleAt(done + i);
+                ids[i] = static_cast<std::uint64_t>(handle.generation) << 32 | handle.index;
+            }
+            block->steps[block->stepCount++] =
+                TrajectoryStep{step, static_cast<std::uint32_t>(at), static_cast<std::uint32_t>(taken)};
+            block->sampleCount += taken;
+            done += taken;
+            samples_ += taken;
+            if (block->sampleCount == BLOCK_SAMPLES || block->stepCount == TRAJECTORY_BLOCK_STEPS) {
+                publish();
+            }
+        }
+    }
+
+    // Writes out everything queued, stops the writer and closes the file.
+    // False if any write failed.
+    bool close() {
+        if (!isOpen()) {
+            return true;
+        }
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) < BLOCKS && blocks_[head % BLOCKS]->stepCount > 0) {
+            publish();
+        }
+        stop_.store(true, std::memory_order_release);
+        writer_.join();
+        bool ok = !failed_.load(std::memory_order_acquire);
+        if (::close(fd_) != 0) {
+            ok = false;
+        }
+        fd_ = -1;
+        if (!ok) {
+            std::cerr << "Failed to write trajectory file " << path_ << std::endl;
+        }
+        return ok;
+    }
+
+    // Main-thread counters; bytesWritten is only final after close()
+    unsigned long long samples() const { return samples_; }
+    unsigned long long droppedSamples() const { return droppedSamples_; }
+    unsigned long long bytesWritten() const { return bytesWritten_; }
+
+private:
+    // One block as it will be written; each part is page-aligned and padded
+    struct Block {
+        AlignedArray<unsigned char> header;
+        AlignedArray<TrajectoryStep> steps;
+        AlignedArray<std::uint64_t> ids;
+        AlignedArray<float> columns[TRAJECTORY_FLOAT_COLUMNS];
+        std::size_t stepCount;
+        std::size_t sampleCount;
+
+        Block() {
+            header.resize(TRAJECTORY_ALIGNMENT);
+            steps.resize(TRAJECTORY_BLOCK_STEPS);
+            ids.resize(BLOCK_SAMPLES);
+            for (AlignedArray<float>& column : columns) {
+                column.resize(BLOCK_SAMPLES);
+            }
+            clear();
+        }
+
+        void clear() {
+            stepCount = 0;
+            sampleCount = 0;
+        }
+    };
+
+    static_assert(BLOCK_SAMPLES * sizeof(float) % TRAJECTORY_ALIGNMENT == 0, "columns fill whole pages");
+
+    // The block sample() appends to, or null if the writer has all of them
+    Block* fillingBlock() {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        while (head - tail_.load(std::memory_order_acquire) == BLOCKS) {
+            if (!waitWhenFull_ || failed_.load(std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            std::this_thread::yield();
+        }
+        return blocks_[head % BLOCKS].get();
+    }
+
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void writerMain() {
+        for (;;) {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire)) {
+                if (stop_.load(std::memory_order_acquire) && tail == head_.load(std::memory_order_acquire)) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            Block& block = *blocks_[tail % BLOCKS];
+            if (!failed_.load(std::memory_order_relaxed) && !writeBlock(block)) {
+                failed_.store(true, std::memory_order_release);
+            }
+            block.clear();
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    bool writeBlock(Block& block) {
+        std::size_t idBytes = alignTrajectoryBytes(block.sampleCount * sizeof(std::uint64_t));
+        std::size_t floatBytes = alignTrajectoryBytes(block.sampleCount * sizeof(float));
+        TrajectoryBlockHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TRAJECTORY_BLOCK_MAGIC, sizeof(header.magic));
+        header.stepCount = static_cast<std::uint32_t>(block.stepCount);
+        header.sampleCount = block.sampleCount;
+        header.blockBytes = 2 * TRAJECTORY_ALIGNMENT + idBytes + TRAJECTORY_FLOAT_COLUMNS * floatBytes;
+        std::memset(block.header.data(), 0, TRAJECTORY_ALIGNMENT);
+        std::memcpy(block.header.data(), &header, sizeof(header));
+
+        // Zero the padding so files do not depend on earlier blocks
+        std::memset(block.steps.data() + block.stepCount, 0,
+                    (TRAJECTORY_BLOCK_STEPS - block.stepCount) * sizeof(TrajectoryStep));
+        std::memset(block.ids.data() + block.sampleCount, 0, idBytes - block.sampleCount * sizeof(std::uint64_t));
+        for (AlignedArray<float>& column : block.columns) {
+            std::memset(column.data() + block.sampleCount, 0, floatBytes - block.sampleCount * sizeof(float));
+        }
+
+        bool ok = writeAll(block.header.data(), TRAJECTORY_ALIGNMENT) &&
+                  writeAll(block.steps.data(), TRAJECTORY_BLOCK_STEPS * sizeof(TrajectoryStep)) &&
+                  writeAll(block.ids.data(), idBytes);
+        for (AlignedArray<float>& column : block.columns) {
+            ok = ok && writeAll(column.data(), floatBytes);
+        }
+        return ok;
+    }
+
+    bool writeAll(const void* data, std::size_t bytes) {
+        const char* next = static_cast<const char*>(data);
+        while (bytes > 0) {
+            ssize_t written = ::write(fd_, next, bytes);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            next += written;
+            bytes -= static_cast<std::size_t>(written);
+            bytesWritten_ += static_cast<unsigned long long>(written);
+        }
+        return true;
+    }
+
+    int fd_;
+    std::string path_;
+    bool waitWhenFull_;
+    std::unique_ptr<Block> blocks_[BLOCKS];
+    // Blocks [tail_, head_) are queued for the writer; blocks_[head_ % BLOCKS] is being filled
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
+    std::atomic<bool> stop_;
+    std::atomic<bool> failed_;
+    std::thread writer_;
+    unsigned long long samples_;
+    unsigned long long droppedSamples_;
+    unsigned long long bytesWritten_; // by the writer thread while it runs
+};
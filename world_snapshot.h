@@ -0,0 +1,304 @@
+#pragma once
+
+#include "fixed_point.h"
+#include "simulation_state.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+// World snapshot file: everything the stepped simulation needs to carry on from
+// a saved moment, laid out to be mmap'd and used in place.
+//   SnapshotHeader, then columnCount SnapshotColumn entries, then the columns,
+//   then two images: the store's handles (SlotMap::saveImage) and the lifetime
+//   timers (TimingWheel::saveImage).
+//   Columns are the projectile store's columns in ProjectileStore::writeColumns
+//   order. Every column and image starts on a PROJECTILE_ALIGNMENT boundary, so
+//   a mapping's arrays are as aligned as the store's own: the SIMD kernels can
+//   run on them directly (see MappedSnapshot::span), and restoring adopts them
+//   instead of copying them.
+// Fields are in host byte order; byteOrder lets a loader spot a foreign file.
+const char SNAPSHOT_MAGIC[4] = {'C', 'N', 'S', 'N'};
+const std::uint32_t SNAPSHOT_VERSION = 2;
+const std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304u;
+
+struct SnapshotHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t fixedPoint; // CANNON_FIXED_POINT of the build that wrote it
+    std::uint64_t projectileCount;
+    std::uint32_t columnCount;
+    std::uint32_t collisions;
+    double stepSeconds;
+    std::uint64_t steps;
+    double simulatedTime;
+    double accumulator;
+    float cannonAngle;
+    float cannonPower;
+    float cannonX;
+    float cannonY;
+    std::uint64_t handleImageOffset; // from the start of the file, like the columns
+    std::uint64_t handleImageBytes;
+    std::uint64_t timerImageOffset;
+    std::uint64_t timerImageBytes;
+};
+
+struct SnapshotColumn {
+    std::uint64_t offset; // from the start of the file
+    std::uint64_t elementSize;
+};
+
+static_assert(std::is_trivially_copyable<SnapshotHeader>::value, "snapshot header is written as bytes");
+
+inline std::uint64_t alignSnapshotOffset(std::uint64_t offset) {
+    return (offset + PROJECTILE_ALIGNMENT - 1) / PROJECTILE_ALIGNMENT * PROJECTILE_ALIGNMENT;
+}
+
+// Writes the world to `path`, one large write per column. The file is written
+// next to it and renamed over it, so a snapshot still mapped from `path` (the
+// store may be using its columns) keeps the contents it was mapped with.
+inline bool saveSnapshot(const std::string& path, const SimulationState& state) {
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open snapshot " << temporaryPath << std::endl;
+        return false;
+    }
+    std::size_t count = state.projectiles.size();
+
+    std::vector<SnapshotColumn> columns;
+    std::vector<const void*> sources;
+    state.projectiles.visitColumns([&](const auto& column) {
+        columns.push_back(SnapshotColumn{0, sizeof(column[0])});
+        sources.push_back(column.data());
+    });
+    std::size_t handleBytes = state.projectiles.handleBytes();
+    std::unique_ptr<unsigned char[]> handleImage(new unsigned char[handleBytes]);
+    state.projectiles.saveHandles(handleImage.get());
+    std::size_t timerBytes = state.lifetimeTimers.imageBytes();
+    std::unique_ptr<unsigned char[]> timerImage(new unsigned char[timerBytes]);
+    state.lifetimeTimers.saveImage(timerImage.get());
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::uint64_t offset = alignSnapshotOffset(sizeof(SnapshotHeader) + columns.size() * sizeof(SnapshotColumn));
+    for (SnapshotColumn& column : columns) {
+        column.offset = offset;
+        offset = alignSnapshotOffset(offset + column.elementSize * count);
+    }
+    header.handleImageOffset = offset;
+    header.handleImageBytes = handleBytes;
+    header.timerImageOffset = alignSnapshotOffset(offset + handleBytes);
+    header.timerImageBytes = timerBytes;
+
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.fixedPoint = CANNON_FIXED_POINT;
+    header.projectileCount = count;
+    header.columnCount = static_cast<std::uint32_t>(columns.size());
+    header.collisions = state.collisions ? 1 : 0;
+    header.stepSeconds = state.clock.stepSeconds();
+    header.steps = state.clock.steps();
+    header.simulatedTime = state.clock.simulatedTime();
+    header.accumulator = state.clock.accumulator();
+    header.cannonAngle = state.cannonAngle;
+    header.cannonPower = state.cannonPower;
+    header.cannonX = state.cannonPosition.x;
+    header.cannonY = state.cannonPosition.y;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(columns.data()), columns.size() * sizeof(SnapshotColumn));
+
+    // Columns, then the images, each padded up to its aligned offset
+    static const char padding[PROJECTILE_ALIGNMENT] = {};
+    std::uint64_t written = sizeof(header) + columns.size() * sizeof(SnapshotColumn);
+    auto writeAt = [&](std::uint64_t at, const void* data, std::uint64_t bytes) {
+        file.write(padding, static_cast<std::streamsize>(at - written));
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written = at + bytes;
+    };
+    for (std::size_t k = 0; k < columns.size(); ++k) {
+        writeAt(columns[k].offset, sources[k], columns[k].elementSize * count);
+    }
+    writeAt(header.handleImageOffset, handleImage.get(), handleBytes);
+    writeAt(header.timerImageOffset, timerImage.get(), timerBytes);
+    file.write(padding, static_cast<std::streamsize>(alignSnapshotOffset(written) - written));
+    file.close();
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write snapshot " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A snapshot file mapped copy-on-write. Opening only maps and checks the
+// header, directory and images, so it costs microseconds for the columns of
+// ten projectiles or ten million; pages are read in as they are first touched.
+// span() views the projectile columns in place, and writes through it stay
+// private to the mapping.
+class MappedSnapshot {
+public:
+    MappedSnapshot() : data_(nullptr), size_(0) {}
+    ~MappedSnapshot() { close(); }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Failed to open snapshot " << path << std::endl;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            std::cerr << "Failed to read snapshot " << path << ": too short" << std::endl;
+            ::close(fd);
+            return false;
+        }
+        std::size_t size = info.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Failed to map snapshot " << path << std::endl;
+            return false;
+        }
+        mapping_.reset(mapping, [size](void* data) { munmap(data, size); });
+        data_ = static_cast<unsigned char*>(mapping);
+        size_ = size;
+        if (!validate(path)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Unmaps the file, unless a store restored from it still uses its columns
+    void close() {
+        mapping_.reset();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool isOpen() const { return data_ != nullptr; }
+    const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(data_); }
+    std::size_t size() const { return header().projectileCount; }
+
+    // The projectile columns where they lie in the mapping
+    ProjectileSpan span() {
+        return ProjectileSpan{column<float>(0), column<float>(1), column<float>(2), column<float>(3),
+                              column<float>(4), column<float>(5), column<std::uint8_t>(6), size()};
+    }
+
+    // Hands the snapshot to the simulation and closes it. The store adopts the
+    // mapped columns and handle image (ProjectileStore::adoptColumns) and the
+    // lifetime timers their image (TimingWheel::adoptImage), so nothing is
+    // copied up front: the first write to each page copies that page,
+    // privately, and the mapping lives until both have outgrown it. Handles
+    // and timers come back exactly as they were saved. The simulation rate has
+    // to match, since timers are due on steps.
+    bool restore(const SimulationState& state) {
+        const SnapshotHeader& saved = header();
+        if (saved.stepSeconds != state.clock.stepSeconds()) {
+            std::cerr << "Failed to restore snapshot: saved at " << 1.0 / saved.stepSeconds << " steps/s, running at "
+                      << 1.0 / state.clock.stepSeconds() << std::endl;
+            return false;
+        }
+        state.projectiles.adoptColumns(size(), [this](std::size_t k) { return data_ + columns()[k].offset; },
+                                       data_ + saved.handleImageOffset, mapping_);
+        state.lifetimeTimers.adoptImage(data_ + saved.timerImageOffset, mapping_);
+        state.clock.restore(saved.steps, saved.simulatedTime, saved.accumulator);
+        state.cannonAngle = saved.cannonAngle;
+        state.cannonPower = saved.cannonPower;
+        state.cannonPosition = glm::vec2(saved.cannonX, saved.cannonY);
+        state.collisions = saved.collisions != 0;
+        close();
+        return true;
+    }
+
+private:
+    const SnapshotColumn* columns() const {
+        return reinterpret_cast<const SnapshotColumn*>(data_ + sizeof(SnapshotHeader));
+    }
+
+    template <typename T>
+    T* column(std::size_t k) const {
+        return reinterpret_cast<T*>(data_ + columns()[k].offset);
+    }
+
+    // Whether `bytes` at `offset` lie in the file, starting on an aligned boundary
+    bool fits(std::uint64_t offset, std::uint64_t bytes) const {
+        return offset % PROJECTILE_ALIGNMENT == 0 && offset <= size_ && bytes <= size_ - offset;
+    }
+
+    // The header must match this build's layout, and every column and image
+    // must fit in the file; images are checked through as loadImage trusts them
+    bool validate(const std::string& path) const {
+        const SnapshotHeader& saved = header();
+        if (std::memcmp(saved.magic, SNAPSHOT_MAGIC, sizeof(saved.magic)) != 0 ||
+            saved.version != SNAPSHOT_VERSION || saved.byteOrder != SNAPSHOT_BYTE_ORDER) {
+            std::cerr << "Failed to read snapshot " << path << ": not a version " << SNAPSHOT_VERSION
+                      << " snapshot for this byte order" << std::endl;
+            return false;
+        }
+        if (saved.fixedPoint != static_cast<std::uint32_t>(CANNON_FIXED_POINT)) {
+            std::cerr << "Failed to read snapshot " << path << ": written by a build with CANNON_FIXED_POINT="
+                      << saved.fixedPoint << ", this one has " << CANNON_FIXED_POINT << std::endl;
+            return false;
+        }
+
+        std::vector<std::uint64_t> elementSizes;
+        ProjectileStore().visitColumns([&](const auto& column) { elementSizes.push_back(sizeof(column[0])); });
+        if (saved.columnCount != elementSizes.size()) {
+            std::cerr << "Failed to read snapshot " << path << ": " << saved.columnCount << " columns, expected "
+                      << elementSizes.size() << std::endl;
+            return false;
+        }
+        if (sizeof(SnapshotHeader) + saved.columnCount * sizeof(SnapshotColumn) > size_) {
+            std::cerr << "Failed to read snapshot " << path << ": column directory is cut short" << std::endl;
+            return false;
+        }
+        for (std::size_t k = 0; k < elementSizes.size(); ++k) {
+            const SnapshotColumn& column = columns()[k];
+            if (column.elementSize != elementSizes[k]) {
+                std::cerr << "Failed to read snapshot " << path << ": column " << k << " has " << column.elementSize
+                          << "-byte elements, expected " << elementSizes[k] << std::endl;
+                return false;
+            }
+            if (saved.projectileCount > (size_ / column.elementSize) ||
+                !fits(column.offset, saved.projectileCount * column.elementSize)) {
+                std::cerr << "Failed to read snapshot " << path << ": column " << k << " is damaged" << std::endl;
+                return false;
+            }
+        }
+        if (!fits(saved.handleImageOffset, saved.handleImageBytes) ||
+            !SlotMap<Projectile>::validImage(data_ + saved.handleImageOffset, saved.handleImageBytes,
+                                             saved.projectileCount)) {
+            std::cerr << "Failed to read snapshot " << path << ": projectile handles are damaged" << std::endl;
+            return false;
+        }
+        if (!fits(saved.timerImageOffset, saved.timerImageBytes) ||
+            !TimingWheel<ProjectileHandle>::validImage(data_ + saved.timerImageOffset, saved.timerImageBytes)) {
+            std::cerr << "Failed to read snapshot " << path << ": lifetime timers are damaged" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<void> mapping_; // shared with a store restored from it
+    unsigned char* data_;
+    std::size_t size_;
+};